@@ -5,16 +5,25 @@
 #include <cstdio>
 #include <cinttypes>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <ctime>
+#include <algorithm>
+#include <atomic>
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <pthread.h>
 
 // Free block identifier
-#define FREE (char*) 0xCAFEFEED
+#define FREE 0xCAFEFEEDU
 
 // Allocated block identifier
-#define ALLOCATED (char*) 0xDEADF00D
+#define ALLOCATED 0xDEADF00DU
 
 // Array that is written at the beginning of each block's padding
-constexpr char END_MARKER[8] = {0x44, 0x45, 0x41, 0x44, 0x43, 0x30, 0x44, 0x45};
+constexpr char END_MARKER[M61_END_MARKER_SIZE] = {0x44, 0x45, 0x41, 0x44, 0x43, 0x30, 0x44, 0x45};
 
 // Alignment used for the blocks
 const size_t ALIGNMENT = alignof(std::max_align_t);
@@ -22,69 +31,353 @@ const size_t ALIGNMENT = alignof(std::max_align_t);
 // Minimum required size for a block
 const size_t MIN_BLOCK_SIZE = sizeof(header) + ALIGNMENT;
 
-// Head node that stores per-allocation metadata
-header* head = nullptr;
-
+// The buffer is constant-initialized and mapped on first use, so allocations made before main (or before this file's
+// static constructors run) are safe. It is never unmapped: allocations may still be freed during static destruction.
+// Default allocations are bumped up from 'pos' and long-lived allocations are bumped down from 'end'.
+// The buffer is capped at the cgroup's memory.max, and its soft limit defaults to the cgroup's memory.high, or to 7/8
+// of memory.max.
 struct m61_memory_buffer {
-    char* buffer;
+    m61_offset_ptr<char> buffer;
     size_t pos = 0;
-    size_t size = 8 << 20; /* 8 MiB */
+    size_t end = 0;
+    size_t size = 0;
+    size_t soft_limit = 0;      // footprint above which memory is reclaimed before the heap grows, or 0 for none
 
-    m61_memory_buffer();
-    ~m61_memory_buffer();
+    bool map();
 };
 
-static m61_memory_buffer default_buffer;
+/// read_cgroup_value(dir, name)
+///    Returns the value of the cgroup v2 interface file `name` in directory `dir`, or SIZE_MAX if it is missing or
+///    "max". Uses raw system calls because it runs before the buffer is mapped, when malloc may be m61_malloc.
+static size_t read_cgroup_value(const char* dir, const char* name) {
+    char path[512];
+    if ((size_t) snprintf(path, sizeof(path), "%s/%s", dir, name) >= sizeof(path)) {
+        return SIZE_MAX;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return SIZE_MAX;
+    }
+    char value[64];
+    ssize_t n = read(fd, value, sizeof(value) - 1);
+    close(fd);
+    if (n <= 0 || value[0] < '0' || value[0] > '9') {
+        return SIZE_MAX;
+    }
+    value[n] = '\0';
+    return strtoull(value, nullptr, 10);
+}
+
+/// get_cgroup_dir(dir, sz)
+///    Stores the cgroup v2 directory of this process in the `sz` bytes long buffer 'dir'. The M61_CGROUP_DIR
+///    environment variable overrides it. Returns false if there is none.
+static bool get_cgroup_dir(char* dir, size_t sz) {
+    if (const char* env_dir = getenv("M61_CGROUP_DIR")) {
+        return (size_t) snprintf(dir, sz, "%s", env_dir) < sz;
+    }
+
+    int fd = open("/proc/self/cgroup", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    char buf[512];
+    ssize_t n = read(fd, buf, sizeof(buf) - 1);
+    close(fd);
+    if (n <= 0) {
+        return false;
+    }
+    buf[n] = '\0';
+
+    // The cgroup v2 entry is "0::<path>"
+    char* entry = strstr(buf, "0::");
+    if (entry == nullptr || (entry != buf && entry[-1] != '\n')) {
+        return false;
+    }
+    entry += 3;
+    entry[strcspn(entry, "\n")] = '\0';
+    return (size_t) snprintf(dir, sz, "/sys/fs/cgroup%s", entry) < sz;
+}
+
+/// m61_memory_buffer::map()
+///    Maps the buffer if it is not mapped yet. The buffer is 8 MiB big unless the M61_HEAP_SIZE environment variable
+///    gives another size in bytes, and no bigger than the cgroup's memory limit. Returns false if the buffer cannot be
+///    mapped.
+bool m61_memory_buffer::map() {
+    if (this->buffer) {
+        return true;
+    }
+
+    size_t buffer_size = 8 << 20; /* 8 MiB */
+    if (const char* heap_size = getenv("M61_HEAP_SIZE")) {
+        buffer_size = strtoull(heap_size, nullptr, 0);
+    }
+
+    char cgroup_dir[512];
+    if (get_cgroup_dir(cgroup_dir, sizeof(cgroup_dir))) {
+        size_t max = read_cgroup_value(cgroup_dir, "memory.max");
+        size_t high = read_cgroup_value(cgroup_dir, "memory.high");
+        buffer_size = std::min(buffer_size, max);
+        if (this->soft_limit == 0 && high != SIZE_MAX) {
+            this->soft_limit = high;
+        } else if (this->soft_limit == 0 && max != SIZE_MAX) {
+            this->soft_limit = max / 8 * 7;
+        }
+    }
 
-m61_memory_buffer::m61_memory_buffer() {
     void* buf = mmap(nullptr,    // Place the buffer at a random address
-                     this->size,              // Buffer should be 8 MiB big
+                     buffer_size,             // Buffer should be 8 MiB big
                      PROT_WRITE,              // We want to read and write the buffer
                      MAP_ANON | MAP_PRIVATE, -1, 0);
     // We want memory freshly allocated by the OS
-    assert(buf != MAP_FAILED);
+    if (buf == MAP_FAILED) {
+        return false;
+    }
     this->buffer = (char*) buf;
+    this->size = buffer_size;
+    this->end = buffer_size;
+    return true;
+}
+
+/// m61_free_space
+///    Free blocks of a heap, counted as they are created, merged and reused. The largest free block is cached and
+///    only searched for again after a block of its size stops being free.
+struct m61_free_space {
+    size_t nblocks = 0;         // # free blocks
+    size_t size = 0;            // # bytes in free blocks
+    size_t largest = 0;         // size of the largest free block if largest_known
+    bool largest_known = true;
+};
+
+/// m61_heap
+///    Allocator state. The m61_malloc family operates on the current heap, which is the process's private heap unless
+///    a shared heap is in use. Other heaps are used through the m61_heap_* functions.
+struct m61_heap {
+    // Head node that stores per-allocation metadata
+    m61_offset_ptr<header> head;
+
+    // Lowest block of the long-lived region at the top of the buffer, or nullptr if that region is empty. The linked
+    // list is ordered by address, so the blocks before it are long-lived and the blocks after it are in the default
+    // region.
+    m61_offset_ptr<header> top_block;
+
+    m61_memory_buffer buffer;
+    m61_statistics stats = {};
+    m61_size_histogram sizes = {};
+    m61_free_space free_space;
+
+    // Process-shared lock of a shared heap, or nullptr for a private heap
+    m61_offset_ptr<pthread_mutex_t> p_lock;
+
+    // Number of frees when reusing a freed block under the soft limit last failed. Scanning again is useless until
+    // more blocks are freed.
+    unsigned long long soft_limit_failed_frees = ULLONG_MAX;
+
+    // Footprint and total freed bytes when the pressure callbacks last ran and free memory was last purged under the
+    // soft limit
+    size_t soft_limit_relieved_footprint = 0;
+    unsigned long long soft_limit_relieved_freed_size = 0;
+};
+
+static m61_heap default_heap;
+
+// Heap used by the m61_malloc family
+static m61_heap* heap = &default_heap;
+
+// Heap of the process: the private heap, or the shared or persistent heap it is attached to. The m61_heap_* functions
+// make `heap` point to a heap instance instead while they run.
+static m61_heap* process_heap = &default_heap;
+
+/// m61_heap_scope
+///    Makes the m61_malloc family use the heap `p_heap` for the scope's lifetime.
+struct m61_heap_scope {
+    m61_heap* p_saved;
+
+    explicit m61_heap_scope(m61_heap* p_heap) : p_saved(heap) {
+        heap = p_heap;
+    }
+
+    ~m61_heap_scope() {
+        heap = p_saved;
+    }
+};
+
+/// m61_heap_guard
+///    Holds the lock of the current heap for the guard's lifetime if the heap is shared with other processes. The lock
+///    is recursive, so public functions that call each other may all take it.
+struct m61_heap_guard {
+    pthread_mutex_t* p_lock;
+
+    m61_heap_guard() : p_lock(heap->p_lock) {
+        // A process died while holding the lock. Its operation may be incomplete, but the others can go on.
+        if (p_lock && pthread_mutex_lock(p_lock) == EOWNERDEAD) {
+            pthread_mutex_consistent(p_lock);
+        }
+    }
+
+    ~m61_heap_guard() {
+        if (p_lock) {
+            pthread_mutex_unlock(p_lock);
+        }
+    }
+};
+
+// Operations whose latencies are recorded
+enum m61_operation {
+    OP_MALLOC, OP_FREE, OP_REALLOC, OP_CALLOC, OP_ALIGNED_ALLOC, OP_MALLOC_BATCH, OP_FREE_BATCH, OP_ARENA_ALLOC,
+    NOPERATIONS
+};
+static const char* const OPERATION_NAMES[NOPERATIONS] = {
+    "malloc", "free", "realloc", "calloc", "aligned_alloc", "malloc_batch", "free_batch", "arena_alloc"
+};
+
+// Latencies below 2^LATENCY_SUB_BITS ns have a bucket each. Above that, each power of two is split into
+// 2^LATENCY_SUB_BITS buckets, so a bucket is at most 1/16 of its latencies wide.
+const int LATENCY_SUB_BITS = 4;
+const int LATENCY_NBUCKETS = (64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS;
+
+/// m61_latency_histogram
+///    Log-linear histogram of the latencies of an operation in nanoseconds. Its counters are updated atomically, so
+///    threads can record into it concurrently, as under the LD_PRELOAD shim.
+struct m61_latency_histogram {
+    std::atomic<unsigned long long> count;
+    std::atomic<unsigned long long> max;
+    std::atomic<unsigned long long> buckets[LATENCY_NBUCKETS];
+};
+
+// Latency histograms of this process, one per operation, shared by all threads
+static m61_latency_histogram latencies[NOPERATIONS];
+
+// Whether the m61_malloc family records its latencies
+static std::atomic<bool> latency_tracking{false};
+
+// Whether the calling thread is timing an operation. Operations called by it, like the m61_malloc in m61_calloc, are
+// not timed.
+static thread_local bool timing_operation = false;
+
+/// get_latency_clock()
+///    Returns the current time in nanoseconds. CLOCK_MONOTONIC is read without a system call.
+static inline unsigned long long get_latency_clock() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/// get_latency_bucket(ns)
+///    Returns the index of the histogram bucket of a latency of `ns` nanoseconds.
+static inline int get_latency_bucket(unsigned long long ns) {
+    if (ns < (1U << LATENCY_SUB_BITS)) {
+        return ns;
+    }
+    int exponent = 63 - __builtin_clzll(ns);
+    int shift = exponent - LATENCY_SUB_BITS;
+    return ((shift + 1) << LATENCY_SUB_BITS) + ((ns >> shift) & ((1U << LATENCY_SUB_BITS) - 1));
 }
 
-m61_memory_buffer::~m61_memory_buffer() {
-    munmap(this->buffer, this->size);
+/// get_latency_bucket_max(bucket)
+///    Returns the largest latency in nanoseconds that falls into bucket `bucket`.
+static unsigned long long get_latency_bucket_max(int bucket) {
+    if (bucket < (1 << LATENCY_SUB_BITS)) {
+        return bucket;
+    }
+    int shift = (bucket >> LATENCY_SUB_BITS) - 1;
+    unsigned long long min = ((1ULL << LATENCY_SUB_BITS) + (bucket & ((1 << LATENCY_SUB_BITS) - 1))) << shift;
+    return min + ((1ULL << shift) - 1);
 }
 
-static m61_statistics gstats = {
-        .nactive = 0,
-        .active_size = 0,
-        .ntotal = 0,
-        .total_size = 0,
-        .nfail = 0,
-        .fail_size = 0,
-        .heap_min = 0,
-        .heap_max = 0
+/// m61_latency_timer
+///    Records the time from its construction to its destruction in the latency histogram of operation 'op', if
+///    latency tracking is enabled and no other operation is being timed.
+struct m61_latency_timer {
+    m61_operation op;
+    bool timed;
+    unsigned long long start;
+
+    explicit m61_latency_timer(m61_operation operation)
+        : op(operation), timed(latency_tracking.load(std::memory_order_relaxed) && !timing_operation) {
+        if (timed) {
+            timing_operation = true;
+            start = get_latency_clock();
+        }
+    }
+
+    ~m61_latency_timer() {
+        if (timed) {
+            unsigned long long ns = get_latency_clock() - start;
+            m61_latency_histogram& histogram = latencies[op];
+            histogram.count.fetch_add(1, std::memory_order_relaxed);
+            histogram.buckets[get_latency_bucket(ns)].fetch_add(1, std::memory_order_relaxed);
+            unsigned long long max = histogram.max.load(std::memory_order_relaxed);
+            while (max < ns && !histogram.max.compare_exchange_weak(max, ns, std::memory_order_relaxed)) {
+            }
+            timing_operation = false;
+        }
+    }
 };
 
 /// add_block(p_header)
 ///    Adds a node to the head of the linked list.
 static void add_block(header* p_header) {
-    p_header->p_next = head;
+    p_header->p_next = heap->head;
     p_header->p_prev = nullptr;
-    if (head) {
-        head->p_prev = p_header;
+    if (heap->head) {
+        heap->head->p_prev = p_header;
+    }
+    heap->head = p_header;
+}
+
+/// insert_after_block(p_header_new, p_header_prev)
+///    Inserts a node into the linked list after a given node. That is, the header pointed to by 'p_header_new' is
+///    inserted into the linked list immediately after the header pointed to by p_header_prev.
+static void insert_after_block(header* p_header_new, header* p_header_prev) {
+    p_header_new->p_prev = p_header_prev;
+    p_header_new->p_next = p_header_prev->p_next;
+    if (p_header_prev->p_next) {
+        p_header_prev->p_next->p_prev = p_header_new;
+    }
+    p_header_prev->p_next = p_header_new;
+}
+
+/// get_pos_block()
+///    Returns the last block of the default region, which ends at the buffer position, or nullptr if the region is
+///    empty.
+static header* get_pos_block() {
+    return heap->top_block ? heap->top_block->p_next : heap->head;
+}
+
+/// add_pos_block(p_header)
+///    Adds a node for a block placed at the buffer position, after the long-lived region in the linked list.
+static void add_pos_block(header* p_header) {
+    if (heap->top_block) {
+        insert_after_block(p_header, heap->top_block);
+    } else {
+        add_block(p_header);
+    }
+}
+
+/// add_top_block(p_header)
+///    Adds a node for a block placed at the end of the buffer, which becomes the lowest long-lived block.
+static void add_top_block(header* p_header) {
+    if (heap->top_block) {
+        insert_after_block(p_header, heap->top_block);
+    } else {
+        add_block(p_header);
     }
-    head = p_header;
+    heap->top_block = p_header;
 }
 
 /// remove_block(p_header)
 ///    Removes a node from the the linked list. Does nothing if the given header pointer is null or if the linked list
 ///    includes no nodes.
 static void remove_block(header* p_header) {
-    if (head == nullptr || p_header == nullptr) {
+    if (heap->head == nullptr || p_header == nullptr) {
         return;
     }
 
     header* p_header_next = p_header->p_next;
     header* p_header_prev = p_header->p_prev;
 
-    if (p_header == head) {
-        head = p_header_next;
+    if (p_header == heap->head) {
+        heap->head = p_header_next;
     }
 
     if (p_header_next) {
@@ -108,6 +401,9 @@ static void insert_before_block(header* p_header_new, header* p_header_next) {
         p_header_next->p_prev->p_next = p_header_new;
     }
     p_header_next->p_prev = p_header_new;
+    if (p_header_next == heap->head) {
+        heap->head = p_header_new;
+    }
 }
 
 /// add_end_marker(ptr)
@@ -153,7 +449,7 @@ static bool is_header_valid(header* p_header, void* p_payload) {
 /// is_block_free(p_header)
 ///    Returns true if the block pointed to by the given header is free. Otherwise, returns false.
 static bool is_block_free(header* p_header) {
-    return p_header && (p_header->p_status == FREE);
+    return p_header && (p_header->status == FREE);
 }
 
 /// is_overflowing(a, b)
@@ -166,49 +462,499 @@ static bool is_overflowing(size_t a, size_t b) {
     return a != c / b || c % b != 0;
 }
 
+/// is_power_of_two(n)
+///    Returns true if 'n' is a nonzero power of two. Otherwise, returns false.
+static bool is_power_of_two(size_t n) {
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+/// get_block_size(sz, p_block_size)
+///    Computes the block size required for a payload of 'sz' bytes, including the header and the padding that holds
+///    END_MARKER, and stores it in 'p_block_size'. Returns false if the block size overflows. Otherwise, returns true.
+static bool get_block_size(size_t sz, size_t* p_block_size) {
+    size_t padding = ALIGNMENT - ((sizeof(header) + sz) % ALIGNMENT);
+
+    // Ensure there is enough space in the padding for END_MARKER
+    if (padding < sizeof(END_MARKER)) {
+        padding += ALIGNMENT;
+    }
+
+    // Check for overflow
+    if (sz > SIZE_MAX - padding - sizeof(header)) {
+        return false;
+    }
+
+    *p_block_size = m61_block_size(sz);
+    return true;
+}
+
 /// get_payload_size(p_header)
 ///    Returns the size of the payload for the given header pointer.
 static size_t get_payload_size(header* p_header) {
-    auto payload_addr = (uintptr_t) p_header->p_payload;
-    return ((uintptr_t) p_header->p_end_marker) - payload_addr;
+    auto payload_addr = (uintptr_t) p_header->p_payload.get();
+    return ((uintptr_t) p_header->p_end_marker.get()) - payload_addr;
+}
+
+/// get_size_class(sz)
+///    Returns the size class of an allocation of `sz` bytes: 0 for 0 bytes, and `i` for sizes in [2^(i-1), 2^i).
+static inline int get_size_class(size_t sz) {
+    return sz ? 64 - __builtin_clzll(sz) : 0;
+}
+
+/// add_to_size_histogram(sz, count)
+///    Counts `count` new allocations of `sz` bytes in the size histogram.
+static inline void add_to_size_histogram(size_t sz, size_t count) {
+    int size_class = get_size_class(sz);
+    heap->sizes.nactive[size_class] += count;
+    heap->sizes.active_size[size_class] += count * sz;
+    heap->sizes.ntotal[size_class] += count;
+    heap->sizes.total_size[size_class] += count * sz;
+}
+
+/// remove_from_size_histogram(sz)
+///    Removes a freed allocation of `sz` bytes from the active counts of the size histogram.
+static inline void remove_from_size_histogram(size_t sz) {
+    int size_class = get_size_class(sz);
+    --heap->sizes.nactive[size_class];
+    heap->sizes.active_size[size_class] -= sz;
+}
+
+/// get_footprint()
+///    Returns the number of bytes of the current heap's buffer covered by blocks.
+static size_t get_footprint() {
+    return heap->buffer.pos + (heap->buffer.size - heap->buffer.end);
+}
+
+/// update_peaks()
+///    Records the current usage of the heap in its peaks if it is higher. Called after allocations, the only
+///    operations that increase usage.
+static inline void update_peaks() {
+    m61_statistics& stats = heap->stats;
+    if (stats.nactive > stats.peak_nactive) {
+        stats.peak_nactive = stats.nactive;
+        stats.peak_nactive_at = stats.ntotal;
+    }
+    if (stats.active_size > stats.peak_active_size) {
+        stats.peak_active_size = stats.active_size;
+        stats.peak_active_size_at = stats.ntotal;
+    }
+    if (stats.heap_max - stats.heap_min > stats.peak_heap_span) {
+        stats.peak_heap_span = stats.heap_max - stats.heap_min;
+        stats.peak_heap_span_at = stats.ntotal;
+    }
+    size_t footprint = get_footprint();
+    if (footprint > stats.peak_footprint) {
+        stats.peak_footprint = footprint;
+        stats.peak_footprint_at = stats.ntotal;
+    }
+}
+
+/// get_heap_offset(ptr)
+///    Returns the distance of `ptr` from the start of the current heap's buffer. The statistics record addresses as
+///    such offsets, so they stay valid wherever a shared or persistent heap is mapped.
+static inline uintptr_t get_heap_offset(const void* ptr) {
+    return (uintptr_t) ptr - (uintptr_t) heap->buffer.buffer.get();
+}
+
+/// is_block_linked(p_header)
+///    Returns true if the block pointed to by the given header is a node of the heap's linked list, i.e. its neighbors
+///    lie inside the heap and point back to it. The links are relative to the header, so a copy of a valid header
+///    elsewhere in the heap has plausible links of its own; only its neighbors can tell it apart.
+static bool is_block_linked(header* p_header) {
+    header* p_next = p_header->p_next;
+    header* p_prev = p_header->p_prev;
+    if (p_next && (get_heap_offset(p_next) >= heap->buffer.size || p_next->p_prev != p_header)) {
+        return false;
+    }
+    if (p_prev) {
+        return get_heap_offset(p_prev) < heap->buffer.size && p_prev->p_next == p_header;
+    }
+    return heap->head == p_header;
 }
 
 /// add_to_statistics(sz, ptr)
 ///    Updates the statistics for allocation. 'sz' is the allocated size and 'ptr' is the pointer for the starting
 ///    address of the allocation.
 static void add_to_statistics(size_t sz, void* ptr) {
-    ++gstats.ntotal;
-    ++gstats.nactive;
-    gstats.total_size += sz;
-    gstats.active_size += sz;
+    ++heap->stats.ntotal;
+    ++heap->stats.nactive;
+    heap->stats.total_size += sz;
+    heap->stats.active_size += sz;
+    add_to_size_histogram(sz, 1);
+
+    uintptr_t offset = get_heap_offset(ptr);
+    if (!heap->stats.heap_min || heap->stats.heap_min > offset) {
+        heap->stats.heap_min = offset;
+    }
+    if (!heap->stats.heap_max || heap->stats.heap_max < offset + sz) {
+        heap->stats.heap_max = offset + sz;
+    }
+    update_peaks();
+}
 
-    if (!gstats.heap_min || gstats.heap_min > (uintptr_t) ptr) {
-        gstats.heap_min = (uintptr_t) ptr;
+/// add_batch_to_statistics(count, sz, min_addr, max_addr)
+///    Updates the statistics for 'count' allocations of 'sz' bytes each at once. 'min_addr' is the lowest payload
+///    address of the batch and 'max_addr' is the end address of its highest payload.
+static void add_batch_to_statistics(size_t count, size_t sz, uintptr_t min_addr, uintptr_t max_addr) {
+    heap->stats.ntotal += count;
+    heap->stats.nactive += count;
+    heap->stats.total_size += count * sz;
+    heap->stats.active_size += count * sz;
+    add_to_size_histogram(sz, count);
+
+    uintptr_t min_offset = get_heap_offset((void*) min_addr);
+    uintptr_t max_offset = get_heap_offset((void*) max_addr);
+    if (!heap->stats.heap_min || heap->stats.heap_min > min_offset) {
+        heap->stats.heap_min = min_offset;
     }
-    if (!gstats.heap_max || gstats.heap_max < (uintptr_t) ptr + sz) {
-        gstats.heap_max = (uintptr_t) ptr + sz;
+    if (!heap->stats.heap_max || heap->stats.heap_max < max_offset) {
+        heap->stats.heap_max = max_offset;
     }
+    update_peaks();
 }
 
 /// remove_from_statistics(size_t sz)
 ///    Updates the statistics for freeing a memory block. 'sz' is the freed size that was previously allocated.
 static void remove_from_statistics(size_t sz) {
-    --gstats.nactive;
-    gstats.active_size -= sz;
+    --heap->stats.nactive;
+    heap->stats.active_size -= sz;
+    remove_from_size_histogram(sz);
 }
 
 /// update_statistics_for_failure(size_t sz)
 ///    Updates the statistics for a failed allocation. 'sz' is the requested size for the failed allocation.
 static void update_statistics_for_failure(size_t sz) {
-    gstats.fail_size += sz ;
-    ++gstats.nfail;
+    heap->stats.fail_size += sz ;
+    ++heap->stats.nfail;
+}
+
+// Capacity of the allocation site table. Must be a power of two.
+const size_t SITE_CAPACITY = 1 << 16;
+
+// Maximum number of slots probed when looking up an allocation site
+const size_t MAX_SITE_PROBES = 64;
+
+// Site id of allocations whose site is not in the site table
+const uint32_t NO_SITE = UINT32_MAX;
+
+// Number of lifetimes a site must have observed before its lifetime is predicted
+const unsigned long long MIN_LIFETIME_SAMPLES = 8;
+
+// Sites whose mean lifetime is below this many allocations are predicted to be short-lived
+const unsigned long long SHORT_LIFETIME = 1 << 12;
+
+// Per-site allocation and lifetime statistics. Lifetimes are measured in allocations, counting the block's own: a
+// block freed right after the next allocation lived for 2. The table is open-addressed on the (file, line) pair and
+// a slot's index is the site id.
+struct m61_site {
+    const char* p_file;                 // source code file of the site, or nullptr if the slot is unused
+    int line;                           // source code line of the site
+    unsigned long long nactive;         // # active allocations
+    unsigned long long active_size;     // # bytes in active allocations
+    unsigned long long ntotal;          // # total allocations
+    unsigned long long total_size;      // # bytes in total allocations
+    unsigned long long nfrees;          // # frees, each of which observed a lifetime
+    unsigned long long total_lifetime;  // sum of the observed lifetimes
+    unsigned long long mean_lifetime;   // moving average of the observed lifetimes
+};
+
+static m61_site sites[SITE_CAPACITY];
+
+// Most recently looked up site. Loops allocate from the same site many times in a row.
+static const char* last_site_file = nullptr;
+static int last_site_line = 0;
+static uint32_t last_site = NO_SITE;
+
+// Whether unhinted allocations are placed according to the predicted lifetime of their site
+static bool lifetime_prediction = true;
+
+/// find_site(file, line)
+///    Returns the id of the allocation site at source code location `file`:`line`, adding the site to the table if
+///    needed. Returns NO_SITE if the site is not in the table and cannot be added.
+static uint32_t find_site(const char* file, int line) {
+    if (file == last_site_file && line == last_site_line) {
+        return last_site;
+    }
+    if (file == nullptr) {
+        return NO_SITE;
+    }
+
+    uint64_t hash = ((uintptr_t) file ^ ((uint64_t) (unsigned) line << 32)) * 0x9E3779B97F4A7C15ULL;
+    size_t slot = (hash >> 32) & (SITE_CAPACITY - 1);
+    uint32_t site = NO_SITE;
+    for (size_t i = 0; i != MAX_SITE_PROBES; ++i, slot = (slot + 1) & (SITE_CAPACITY - 1)) {
+        if (sites[slot].p_file == nullptr) {
+            sites[slot].p_file = file;
+            sites[slot].line = line;
+        }
+        if (sites[slot].p_file == file && sites[slot].line == line) {
+            site = (uint32_t) slot;
+            break;
+        }
+    }
+
+    last_site_file = file;
+    last_site_line = line;
+    last_site = site;
+    return site;
+}
+
+// Source location of blocks allocated by an earlier process
+static const char PREVIOUS_RUN[] = "<previous run>";
+
+/// get_image_tag()
+///    Returns a tag of this process's image. Processes whose source location strings are at different addresses, such
+///    as separate runs of a position-independent executable, have different tags.
+static uint32_t get_image_tag() {
+    return (uint32_t) ((uintptr_t) PREVIOUS_RUN >> 4);
+}
+
+/// is_foreign_block(p_header)
+///    Returns true if the source location in the given header points into the image of another process, so this
+///    process cannot read it. The site field of shared heap blocks holds the image tag of the allocating process.
+static bool is_foreign_block(header* p_header) {
+    return heap->p_lock && p_header->site != get_image_tag();
+}
+
+/// get_block_file(p_header), get_block_line(p_header)
+///    Return the source location recorded in the given header, or PREVIOUS_RUN:0 if it belongs to another process.
+static const char* get_block_file(header* p_header) {
+    return is_foreign_block(p_header) ? PREVIOUS_RUN : p_header->p_file;
+}
+
+static int get_block_line(header* p_header) {
+    return is_foreign_block(p_header) ? 0 : p_header->line;
+}
+
+// Number of active marks. Lifetimes are not predicted while a mark is active, so that allocations made inside the
+// scope bump up from the mark and are released with it.
+static unsigned mark_depth = 0;
+
+// Number of blocks allocated while a mark was active that neither start nor end at the buffer position. Only these
+// may escape a mark, so releasing a mark looks for escapes only if this grew since the mark was taken.
+static unsigned long long mark_noutside = 0;
+
+// Number of nested marks whose totals are tracked. Releasing a mark nested deeper walks the released blocks.
+const unsigned MAX_MARK_DEPTH = 16;
+
+// Number of allocation sites whose totals a mark tracks
+const size_t MARK_NSITES = 4;
+
+/// m61_mark_site
+///    Totals of the active allocations from one site that a mark tracks.
+struct m61_mark_site {
+    uint32_t site;
+    unsigned long long nactive;
+    unsigned long long active_size;
+    unsigned long long clock_sum;       // sum of the allocation clocks of the active allocations
+};
+
+/// m61_mark_totals
+///    Running totals of the active allocations placed at the buffer position while a mark was the innermost one.
+///    Releasing the mark subtracts them from the statistics instead of walking the released blocks.
+struct m61_mark_totals {
+    m61_heap* p_heap;                   // heap the mark was taken on
+    unsigned long long ntotal;          // # total allocations when the mark was taken
+    unsigned long long nactive;
+    unsigned long long active_size;
+    size_t block_size;                  // # bytes in the blocks of the active allocations
+    unsigned long long size_nactive[M61_NSIZE_CLASSES];
+    unsigned long long size_active_size[M61_NSIZE_CLASSES];
+    m61_mark_site sites[MARK_NSITES];
+    size_t nsites;
+    bool untracked;                     // whether an allocation's site did not fit in 'sites'
+};
+
+static m61_mark_totals mark_totals[MAX_MARK_DEPTH];
+
+/// add_to_mark_totals(p_header, sz)
+///    Adds the block pointed to by the given header pointer, which was just placed at the buffer position for an
+///    allocation of `sz` bytes, to the totals of the innermost mark.
+static void add_to_mark_totals(header* p_header, size_t sz) {
+    if (mark_depth > MAX_MARK_DEPTH || mark_totals[mark_depth - 1].p_heap != heap) {
+        return;
+    }
+    m61_mark_totals& totals = mark_totals[mark_depth - 1];
+    ++totals.nactive;
+    totals.active_size += sz;
+    totals.block_size += p_header->block_size;
+    int size_class = get_size_class(sz);
+    ++totals.size_nactive[size_class];
+    totals.size_active_size[size_class] += sz;
+
+    if (heap->p_lock || p_header->site == NO_SITE) {
+        return;
+    }
+    m61_mark_site* p_site = std::find_if(totals.sites, totals.sites + totals.nsites, [&](const m61_mark_site& site) {
+        return site.site == p_header->site;
+    });
+    if (p_site == totals.sites + totals.nsites) {
+        if (totals.nsites == MARK_NSITES) {
+            totals.untracked = true;
+            return;
+        }
+        *p_site = {p_header->site, 0, 0, 0};
+        ++totals.nsites;
+    }
+    ++p_site->nactive;
+    p_site->active_size += sz;
+    p_site->clock_sum += p_header->alloc_clock;
+}
+
+/// remove_from_mark_totals(p_header, block_size)
+///    Removes the allocated block pointed to by the given header pointer, which is being freed and was counted with
+///    'block_size' bytes, from the totals of the innermost mark it was allocated since.
+static void remove_from_mark_totals(header* p_header, size_t block_size) {
+    for (unsigned i = std::min(mark_depth, MAX_MARK_DEPTH); i-- != 0; ) {
+        m61_mark_totals& totals = mark_totals[i];
+        uint32_t nallocs = (uint32_t) (heap->stats.ntotal - totals.ntotal);
+        if (totals.p_heap != heap || (uint32_t) (p_header->alloc_clock - (uint32_t) totals.ntotal) >= nallocs) {
+            continue;
+        }
+
+        size_t sz = get_payload_size(p_header);
+        --totals.nactive;
+        totals.active_size -= sz;
+        totals.block_size -= block_size;
+        int size_class = get_size_class(sz);
+        --totals.size_nactive[size_class];
+        totals.size_active_size[size_class] -= sz;
+        for (size_t j = 0; j != totals.nsites; ++j) {
+            if (totals.sites[j].site == p_header->site) {
+                --totals.sites[j].nactive;
+                totals.sites[j].active_size -= sz;
+                totals.sites[j].clock_sum -= p_header->alloc_clock;
+            }
+        }
+        return;
+    }
+}
+
+/// set_alloc_site(p_header, sz, file, line)
+///    Records that the block pointed to by the given header pointer was allocated with size `sz` at source code
+///    location `file`:`line` by the current allocation. Blocks of shared heaps have no site, because other processes,
+///    whose site tables differ, may free them. Their site field holds the image tag of this process instead.
+static void set_alloc_site(header* p_header, size_t sz, const char* file, int line) {
+    p_header->alloc_clock = (uint32_t) heap->stats.ntotal;
+    char* p_pos = heap->buffer.buffer + heap->buffer.pos;
+    bool at_pos = (char*) p_header == p_pos || (char*) p_header + p_header->block_size == p_pos;
+    if (mark_depth && !at_pos) {
+        ++mark_noutside;
+    }
+    if (heap->p_lock) {
+        p_header->site = get_image_tag();
+    } else {
+        uint32_t site_id = find_site(file, line);
+        p_header->site = site_id;
+        if (site_id != NO_SITE) {
+            m61_site& site = sites[site_id];
+            ++site.nactive;
+            site.active_size += sz;
+            ++site.ntotal;
+            site.total_size += sz;
+        }
+    }
+    if (mark_depth && at_pos) {
+        add_to_mark_totals(p_header, sz);
+    }
+}
+
+/// record_site_free(p_header)
+///    Removes the allocated block pointed to by the given header pointer, which is being freed, from the active
+///    allocations of its allocation site and adds its lifetime to the site's statistics.
+static void record_site_free(header* p_header) {
+    if (heap->p_lock || p_header->site == NO_SITE) {
+        return;
+    }
+    m61_site& site = sites[p_header->site];
+    // Restoring a snapshot replaces the site table, which then does not count the blocks of heap instances allocated
+    // before it
+    if (site.nactive == 0) {
+        return;
+    }
+    size_t sz = get_payload_size(p_header);
+    --site.nactive;
+    site.active_size -= std::min<unsigned long long>(sz, site.active_size);
+
+    unsigned long long lifetime = (uint32_t) ((uint32_t) heap->stats.ntotal - p_header->alloc_clock);
+    site.total_lifetime += lifetime;
+    if (site.nfrees == 0) {
+        site.mean_lifetime = lifetime;
+    } else {
+        // Exponential moving average with weight 1/8, so sites that change behavior are followed
+        site.mean_lifetime = site.mean_lifetime - site.mean_lifetime / 8 + lifetime / 8;
+    }
+    ++site.nfrees;
+}
+
+/// predict_lifetime(file, line)
+///    Returns M61_SHORT_LIVED or M61_LONG_LIVED if the allocation site at source code location `file`:`line` has
+///    observed enough lifetimes to predict one, or 0 otherwise.
+static int predict_lifetime(const char* file, int line) {
+    if (!lifetime_prediction || mark_depth) {
+        return 0;
+    }
+    uint32_t site = find_site(file, line);
+    if (site == NO_SITE || sites[site].nfrees < MIN_LIFETIME_SAMPLES) {
+        return 0;
+    }
+    return sites[site].mean_lifetime < SHORT_LIFETIME ? M61_SHORT_LIVED : M61_LONG_LIVED;
+}
+
+/// add_free_space(block_size)
+///    Counts a new free block of 'block_size' bytes.
+static inline void add_free_space(size_t block_size) {
+    m61_free_space& free_space = heap->free_space;
+    ++free_space.nblocks;
+    free_space.size += block_size;
+    if (free_space.largest_known && free_space.largest < block_size) {
+        free_space.largest = block_size;
+    }
+}
+
+/// remove_free_space(block_size)
+///    Stops counting a free block of 'block_size' bytes that is removed or reused.
+static inline void remove_free_space(size_t block_size) {
+    m61_free_space& free_space = heap->free_space;
+    --free_space.nblocks;
+    free_space.size -= block_size;
+    if (free_space.largest == block_size) {
+        free_space.largest_known = false;
+    }
+}
+
+/// merge_free_space(size_a, size_b)
+///    Counts two adjacent free blocks of 'size_a' and 'size_b' bytes as one.
+static inline void merge_free_space(size_t size_a, size_t size_b) {
+    // Count the merged block first, so that it takes over from a largest block instead of invalidating it
+    add_free_space(size_a + size_b);
+    remove_free_space(size_a);
+    remove_free_space(size_b);
+}
+
+/// get_largest_free_block()
+///    Returns the size of the largest free block of the current heap, searching the block list only if the cached
+///    size is out of date.
+static size_t get_largest_free_block() {
+    m61_free_space& free_space = heap->free_space;
+    if (!free_space.largest_known) {
+        free_space.largest = 0;
+        for (header* p = heap->head; p; p = p->p_next) {
+            if (p->status == FREE && free_space.largest < p->block_size) {
+                free_space.largest = p->block_size;
+            }
+        }
+        free_space.largest_known = true;
+    }
+    return free_space.largest;
 }
 
 /// can_coalesce_up(p_header)
 ///    Returns true if the block pointed to by the given header pointer can be merged with its predecessor. Otherwise,
 ///    returns false.
 static bool can_coalesce_up(header* p_header) {
-    if (!is_block_free(p_header->p_prev)) {
+    // The last block of the default region and top_block are not adjacent in memory
+    if (!is_block_free(p_header->p_prev) || p_header->p_prev == heap->top_block) {
         return false;
     }
     assert(p_header->p_prev->p_next == p_header);
@@ -219,7 +965,7 @@ static bool can_coalesce_up(header* p_header) {
 ///    Returns true if the block pointed to by the given header pointer can be merged with its successor. Otherwise,
 ///    returns false.
 static bool can_coalesce_down(header* p_header) {
-    if (!is_block_free(p_header->p_next)) {
+    if (!is_block_free(p_header->p_next) || p_header == heap->top_block) {
         return false;
     }
     assert(p_header->p_next->p_prev == p_header);
@@ -232,26 +978,38 @@ static bool can_coalesce_down(header* p_header) {
 static void coalesce(header* p_header) {
     // Try to merge the current block with its predecessor
     if (can_coalesce_up(p_header)) {
+        merge_free_space(p_header->block_size, p_header->p_prev->block_size);
         p_header->block_size += p_header->p_prev->block_size;
         remove_block(p_header->p_prev);
     }
 
     // Try to merge the current block with its successor
     if (can_coalesce_down(p_header)) {
+        merge_free_space(p_header->p_next->block_size, p_header->block_size);
         p_header->p_next->block_size += p_header->block_size;
         remove_block(p_header);
     }
 }
 
 /// move_buffer_pos()
-///    If the last block in the linked list (head) is a free block, moves the buffer position to the starting address
-///    of the last block and removes that block from the linked list.
+///    If the last block of the default region is a free block, moves the buffer position to the starting address of
+///    that block and removes it from the linked list. Likewise, if top_block is a free block, moves the buffer end to
+///    the end of that block and removes it from the linked list.
 static void move_buffer_pos() {
-    if (head == nullptr || head->p_status == ALLOCATED) {
-        return;
+    header* p_pos_block = get_pos_block();
+    if (is_block_free(p_pos_block)) {
+        heap->buffer.pos -= p_pos_block->block_size;
+        remove_free_space(p_pos_block->block_size);
+        remove_block(p_pos_block);
+    }
+
+    if (is_block_free(heap->top_block)) {
+        header* p_header = heap->top_block;
+        heap->buffer.end += p_header->block_size;
+        remove_free_space(p_header->block_size);
+        heap->top_block = p_header->p_prev;
+        remove_block(p_header);
     }
-    default_buffer.pos -= head->block_size;
-    remove_block(head);
 }
 
 /// report_ptr_inside_alloc_block(ptr)
@@ -260,21 +1018,22 @@ static void report_ptr_inside_alloc_block(void* ptr) {
 
     auto ptr_addr = (uintptr_t) ptr;
 
-    header* p_header = head;
+    header* p_header = heap->head;
     while (p_header) {
-        if (p_header->p_status != ALLOCATED) {
+        if (p_header->status != ALLOCATED) {
+            p_header = p_header->p_next;
             continue;
         }
 
-        auto payload_addr = (uintptr_t) p_header->p_payload;
-        auto end_marker_addr = (uintptr_t) p_header->p_end_marker;
+        auto payload_addr = (uintptr_t) p_header->p_payload.get();
+        auto end_marker_addr = (uintptr_t) p_header->p_end_marker.get();
 
         // Check if the given pointer is between the payload's and end marker's starting addresses
         if (payload_addr <= ptr_addr && ptr_addr < end_marker_addr) {
             size_t offset = ptr_addr - payload_addr;
             size_t payload_size = get_payload_size(p_header);
-            fprintf(stderr, "  %s:%d: %p is %zu bytes inside a %zu byte region allocated here\n", p_header->p_file,
-                    p_header->line, ptr, offset, payload_size);
+            fprintf(stderr, "  %s:%d: %p is %zu bytes inside a %zu byte region allocated here\n",
+                    get_block_file(p_header), get_block_line(p_header), ptr, offset, payload_size);
             return;
         }
         p_header = p_header->p_next;
@@ -303,9 +1062,10 @@ static header* generate_alloc_block(void* ptr, size_t block_size, size_t payload
     // First create a generic block and get the pointer of its header
     auto p_header = generate_generic_block(ptr, block_size, file, line);
 
-    p_header->p_status = ALLOCATED;
+    p_header->status = ALLOCATED;
     p_header->p_end_marker = p_header->p_payload + payload_size;
     add_end_marker(p_header->p_end_marker);
+    set_alloc_site(p_header, payload_size, file, line);
 
     return p_header;
 }
@@ -318,7 +1078,7 @@ static header* generate_free_block(void* ptr, size_t block_size, const char* fil
     // First create a generic block and get the pointer of its header
     auto p_header = generate_generic_block(ptr, block_size, file, line);
 
-    p_header->p_status = FREE;
+    p_header->status = FREE;
     p_header->p_end_marker = nullptr;
 
     return p_header;
@@ -340,26 +1100,35 @@ static void split_block(header* p_header, size_t required_size) {
 
     // Insert the new free block into the linked list and adjust the block size of p_header
     insert_before_block(p_header_new, p_header);
+    add_free_space(residual_size);
     p_header->block_size = required_size;
 }
 
-/// find_freed_block(required_size, payload_size, file, line)
+/// find_freed_block(required_size, payload_size, file, line, p_first)
 ///    Traverses the linked list of blocks to find a free block that is at least as large as 'required_size'.
-///    'required_size' is the block size that includes the header and padding. If a block is found, the block is
-///    converted to an allocated block and the split_block function is called to split the block if possible. If no
-///    block is found then nullptr is returned.
-static void* find_freed_block(size_t required_size, size_t payload_size, const char* file, int line) {
-    header* p_header = head;
-    while (p_header) {
-        if (p_header->p_status == FREE && p_header->block_size >= required_size) {
+///    'required_size' is the block size that includes the header and padding. The traversal starts at 'p_first' (or
+///    head if it is null) and wraps around to head. If a block is found, the block is converted to an allocated block
+///    and the split_block function is called to split the block if possible. If no block is found then nullptr is
+///    returned.
+static void* find_freed_block(size_t required_size, size_t payload_size, const char* file, int line,
+                              header* p_first) {
+    if (heap->head == nullptr) {
+        return nullptr;
+    }
+
+    header* p_start = p_first ? p_first : heap->head.get();
+    header* p_header = p_start;
+    do {
+        if (p_header->status == FREE && p_header->block_size >= required_size) {
             // Allocate the block and then try to split it in case there is left over extra space
+            remove_free_space(p_header->block_size);
             p_header = generate_alloc_block((void*) p_header, p_header->block_size, payload_size, file, line);
             split_block(p_header, required_size);
 
             return p_header->p_payload;
         }
-        p_header = p_header->p_next;
-    }
+        p_header = p_header->p_next ? p_header->p_next : heap->head;
+    } while (p_header != p_start);
 
     return nullptr;
 }
@@ -371,71 +1140,389 @@ static void* find_freed_block(size_t required_size, size_t payload_size, const c
 ///    at source code location `file`:`line`. If it succeeds, returns a pointer for the payload. Otherwise, returns
 ///    nullptr.
 static void* find_free_space(size_t block_size, size_t payload_size, const char* file, int line) {
+    if (!heap->buffer.map()) {
+        return nullptr;
+    }
+
     // Check if there is enough space in the default buffer
-    if (default_buffer.size - default_buffer.pos >= block_size) {
-        void* ptr = &default_buffer.buffer[default_buffer.pos];
+    if (heap->buffer.end - heap->buffer.pos >= block_size) {
+        void* ptr = &heap->buffer.buffer[heap->buffer.pos];
         header* p_header = generate_alloc_block(ptr, block_size, payload_size, file, line);
-        add_block(p_header);
-        default_buffer.pos += block_size;
+        add_pos_block(p_header);
+        heap->buffer.pos += block_size;
 
         return p_header->p_payload;
     }
 
-    // Otherwise try to find a free space among the freed blocks
-    return find_freed_block(block_size, payload_size, file, line);
+    // Otherwise try to find a free space among the freed blocks, starting with the default region
+    return find_freed_block(block_size, payload_size, file, line, get_pos_block());
 }
 
-/// m61_malloc(sz, p_file, line)
-///    Returns a pointer to `sz` bytes of freshly-allocated dynamic memory.
-///    The memory is not initialized. If `sz == 0`, then m61_malloc may
-///    return either `nullptr` or a pointer to a unique allocation.
-///    The allocation request was made at source code location `file`:`line`.
-void* m61_malloc(size_t sz, const char* file, int line) {
-    (void) file, (void) line;   // avoid uninitialized variable warnings
+/// find_top_space(block_size, payload_size, file, line)
+///    Like find_free_space, but for long-lived allocations: takes space from the end of the default buffer, or else
+///    searches the freed blocks starting with the long-lived region.
+static void* find_top_space(size_t block_size, size_t payload_size, const char* file, int line) {
+    if (!heap->buffer.map()) {
+        return nullptr;
+    }
 
-    size_t padding = ALIGNMENT - ((sizeof(header) + sz) % ALIGNMENT);
+    // Check if there is enough space in the default buffer
+    if (heap->buffer.end - heap->buffer.pos >= block_size) {
+        heap->buffer.end -= block_size;
+        void* ptr = &heap->buffer.buffer[heap->buffer.end];
+        header* p_header = generate_alloc_block(ptr, block_size, payload_size, file, line);
+        add_top_block(p_header);
 
-    // Ensure there is enough space in the padding for END_MARKER
-    if (padding < sizeof(END_MARKER)) {
-        padding += ALIGNMENT;
+        return p_header->p_payload;
     }
 
-    // Check for overflow
-    if (sz > SIZE_MAX - padding - sizeof(header)) {
-        update_statistics_for_failure(sz);
-        return nullptr;
+    // Otherwise try to find a free space among the freed blocks
+    return find_freed_block(block_size, payload_size, file, line, heap->head);
+}
+
+/// get_aligned_slack(addr, alignment)
+///    Returns the number of bytes that must be skipped from 'addr' so that a block starting there has its payload
+///    aligned to 'alignment'. The result is either 0 or at least MIN_BLOCK_SIZE, so that the skipped bytes can always
+///    form a free block of their own.
+static size_t get_aligned_slack(uintptr_t addr, size_t alignment) {
+    uintptr_t payload_addr = addr + sizeof(header);
+    size_t slack = (alignment - payload_addr % alignment) % alignment;
+    while (slack != 0 && slack < MIN_BLOCK_SIZE) {
+        slack += alignment;
     }
+    return slack;
+}
 
-    size_t block_size = sizeof(header) + sz + padding;
+/// find_aligned_freed_block(alignment, block_size, payload_size, file, line)
+///    Finds a free block that can hold a block of 'block_size' bytes whose payload is aligned to 'alignment' and
+///    allocates it. The leading slack in front of the block is kept as a free block. If it succeeds, returns a pointer
+///    for the payload. Otherwise, returns nullptr.
+static void* find_aligned_freed_block(size_t alignment, size_t block_size, size_t payload_size, const char* file,
+                                      int line) {
+    header* p_header = heap->head;
+    while (p_header) {
+        if (p_header->status == FREE) {
+            size_t slack = get_aligned_slack((uintptr_t) p_header, alignment);
+            if (p_header->block_size >= slack && p_header->block_size - slack >= block_size) {
+                // Keep the leading slack as a free block and carve the aligned block out of the rest
+                remove_free_space(p_header->block_size);
+                if (slack) {
+                    add_free_space(slack);
+                    header* p_header_new = generate_free_block((char*) p_header + slack, p_header->block_size - slack,
+                                                               file, line);
+                    insert_before_block(p_header_new, p_header);
+                    p_header->block_size = slack;
+                    p_header = p_header_new;
+                }
+                p_header = generate_alloc_block((void*) p_header, p_header->block_size, payload_size, file, line);
+                split_block(p_header, block_size);
+
+                return p_header->p_payload;
+            }
+        }
+        p_header = p_header->p_next;
+    }
 
-    void* p_payload = find_free_space(block_size, sz, file, line);
+    return nullptr;
+}
 
-    // Check if failed
-    if (p_payload == nullptr) {
-        update_statistics_for_failure(sz);
+/// find_aligned_space(alignment, block_size, payload_size, file, line)
+///    Like find_free_space, but places the block so that its payload is aligned to 'alignment'. The leading slack in
+///    front of the block is turned into a free block instead of being wasted. If it succeeds, returns a pointer for
+///    the payload. Otherwise, returns nullptr.
+static void* find_aligned_space(size_t alignment, size_t block_size, size_t payload_size, const char* file,
+                                int line) {
+    if (!heap->buffer.map()) {
         return nullptr;
     }
 
-    add_to_statistics(sz, p_payload);
+    // Check if there is enough space in the default buffer
+    char* ptr = &heap->buffer.buffer[heap->buffer.pos];
+    size_t slack = get_aligned_slack((uintptr_t) ptr, alignment);
+    size_t available = heap->buffer.end - heap->buffer.pos;
+    if (available >= block_size && available - block_size >= slack) {
+        if (slack) {
+            add_pos_block(generate_free_block(ptr, slack, file, line));
+            add_free_space(slack);
+        }
+        header* p_header = generate_alloc_block(ptr + slack, block_size, payload_size, file, line);
+        add_pos_block(p_header);
+        heap->buffer.pos += slack + block_size;
+
+        return p_header->p_payload;
+    }
 
-    return (void*) p_payload;
+    // Otherwise try to find a free block that can hold an aligned payload
+    return find_aligned_freed_block(alignment, block_size, payload_size, file, line);
 }
 
-/// m61_free(ptr, p_file, line)
-///    Frees the memory allocation pointed to by `ptr`. If `ptr == nullptr`,
-///    does nothing. Otherwise, `ptr` must point to a currently active
-///    allocation returned by `m61_malloc`. The free was called at location
-///    `p_file`:`line`.
-void m61_free(void* ptr, const char* file, int line) {
-    // avoid uninitialized variable warnings
-    (void) ptr, (void) file, (void) line;
+// Size of a slot of the emergency reserve
+const size_t RESERVE_SLOT_SIZE = 1 << 10;
 
-    if (ptr == nullptr) {
-        return;
+// Number of slots of the emergency reserve, one per bit of reserve_slots
+const size_t RESERVE_NSLOTS = 64;
+
+/// m61_reserve_header
+///    Header of an allocation from the emergency reserve. The allocation takes 'nslots' consecutive slots.
+struct alignas(alignof(std::max_align_t)) m61_reserve_header {
+    size_t size;                // requested size
+    uint32_t nslots;            // # slots taken
+    uint32_t counted;           // whether the allocation is counted in the heap statistics
+};
+
+// Emergency reserve. It is preallocated, so it is available when the heap is exhausted, and it is managed with a
+// single atomic bitmap, so it can be used from signal handlers. Its slots are aligned to their size.
+alignas(RESERVE_SLOT_SIZE) static char reserve[RESERVE_NSLOTS * RESERVE_SLOT_SIZE];
+static std::atomic<uint64_t> reserve_slots{0};
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "the emergency reserve must be lock-free");
+
+/// is_reserve_pointer(ptr)
+///    Returns true if `ptr` points into the emergency reserve.
+static bool is_reserve_pointer(const void* ptr) {
+    return (const char*) ptr >= reserve && (const char*) ptr < reserve + sizeof(reserve);
+}
+
+/// reserve_alloc(sz, counted, alignment)
+///    Takes `sz` bytes aligned to 'alignment' from the emergency reserve and returns a pointer to them, or nullptr if
+///    the reserve has no room. 'alignment' is a power of two no larger than RESERVE_SLOT_SIZE. Async-signal-safe.
+static void* reserve_alloc(size_t sz, bool counted, size_t alignment) {
+    // The payload starts 'offset' bytes into its first slot, so the header is always in that slot
+    size_t offset = std::max(alignment, sizeof(m61_reserve_header));
+    if (alignment > RESERVE_SLOT_SIZE || sz > sizeof(reserve) - offset) {
+        return nullptr;
+    }
+    size_t nslots = (sz + offset + RESERVE_SLOT_SIZE - 1) / RESERVE_SLOT_SIZE;
+    uint64_t mask = nslots == 64 ? ~0ULL : (1ULL << nslots) - 1;
+
+    uint64_t slots = reserve_slots.load(std::memory_order_relaxed);
+    size_t i = 0;
+    while (i + nslots <= RESERVE_NSLOTS) {
+        if (slots & (mask << i)) {
+            ++i;
+        } else if (reserve_slots.compare_exchange_weak(slots, slots | (mask << i), std::memory_order_acquire,
+                                                       std::memory_order_relaxed)) {
+            auto p_header = (m61_reserve_header*) (reserve + i * RESERVE_SLOT_SIZE + offset) - 1;
+            p_header->size = sz;
+            p_header->nslots = nslots;
+            p_header->counted = counted;
+            return p_header + 1;
+        }
+        // Otherwise 'slots' was reloaded by the failed exchange: retry at the same position
+    }
+    return nullptr;
+}
+
+/// reserve_free(ptr)
+///    Returns the emergency reserve allocation pointed to by `ptr` to the reserve. Async-signal-safe.
+static void reserve_free(void* ptr) {
+    auto p_header = ((m61_reserve_header*) ptr) - 1;
+    size_t i = ((char*) p_header - reserve) / RESERVE_SLOT_SIZE;
+    uint64_t mask = p_header->nslots == 64 ? ~0ULL : (1ULL << p_header->nslots) - 1;
+    reserve_slots.fetch_and(~(mask << i), std::memory_order_release);
+}
+
+/// get_owning_heap(ptr)
+///    Returns the heap that the allocation pointed to by `ptr` is freed in. While a shared or persistent heap is
+///    current, allocations made from the private heap before it, including those from the emergency reserve, are
+///    still freed in the private heap.
+static m61_heap* get_owning_heap(const void* ptr) {
+    if (heap == &default_heap || ptr == nullptr) {
+        return heap;
+    }
+    const m61_memory_buffer& buffer = default_heap.buffer;
+    if (is_reserve_pointer(ptr)
+        || (buffer.buffer && (const char*) ptr >= buffer.buffer && (const char*) ptr < buffer.buffer + buffer.size)) {
+        return &default_heap;
+    }
+    return heap;
+}
+
+/// release_reserve_allocation(ptr)
+///    Frees the emergency reserve allocation pointed to by `ptr` that was returned by the m61_malloc family. Only the
+///    private heap allocates from the reserve, so its statistics are updated whichever heap is current.
+static void release_reserve_allocation(void* ptr) {
+    auto p_header = ((m61_reserve_header*) ptr) - 1;
+    if (p_header->counted) {
+        m61_heap_scope scope(&default_heap);
+        remove_from_statistics(p_header->size);
+    }
+    reserve_free(ptr);
+}
+
+// Maximum number of registered pressure callbacks
+const size_t MAX_PRESSURE_CALLBACKS = 16;
+
+/// m61_pressure_entry
+///    Registered pressure callback.
+struct m61_pressure_entry {
+    m61_pressure_callback callback;
+    void* arg;
+};
+
+static m61_pressure_entry pressure_callbacks[MAX_PRESSURE_CALLBACKS];
+static size_t npressure_callbacks = 0;
+
+// Whether the pressure callbacks are running. Allocations they make do not call them again.
+static bool relieving_pressure = false;
+
+/// relieve_pressure(sz)
+///    Calls the registered pressure callbacks because an allocation of `sz` bytes does not fit in the current heap.
+///    The callbacks get the heap instance that is out of memory, or nullptr for the process's heap, and run with the
+///    m61_malloc family using the process's heap. Returns true if any callback was called, so the allocation is worth
+///    retrying.
+static bool relieve_pressure(size_t sz) {
+    if (relieving_pressure || npressure_callbacks == 0) {
+        return false;
+    }
+    m61_heap* p_heap = heap == process_heap ? nullptr : heap;
+    m61_heap_scope scope(process_heap);
+    relieving_pressure = true;
+    for (size_t i = 0; i != npressure_callbacks; ++i) {
+        pressure_callbacks[i].callback(p_heap, sz, pressure_callbacks[i].arg);
+    }
+    relieving_pressure = false;
+    return true;
+}
+
+/// place_block(block_size, sz, hint, alignment, file, line)
+///    Finds space for a block of 'block_size' bytes for an allocation of `sz` bytes in the region that `hint` asks for
+///    and returns its payload pointer, or nullptr if the heap has no room. Blocks whose payload needs a larger
+///    'alignment' than ALIGNMENT are placed in the default region. Does not update the statistics.
+static void* place_block(size_t block_size, size_t sz, int hint, size_t alignment, const char* file, int line) {
+    if (alignment > ALIGNMENT) {
+        return find_aligned_space(alignment, block_size, sz, file, line);
+    } else if (hint & M61_LONG_LIVED) {
+        return find_top_space(block_size, sz, file, line);
+    }
+    return find_free_space(block_size, sz, file, line);
+}
+
+/// purge_free_memory()
+///    Returns the pages of the current heap's buffer that are not covered by blocks to the operating system.
+static void purge_free_memory() {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    uintptr_t start = ((uintptr_t) heap->buffer.buffer.get() + heap->buffer.pos + page_size - 1) / page_size * page_size;
+    uintptr_t end = ((uintptr_t) heap->buffer.buffer.get() + heap->buffer.end) / page_size * page_size;
+    if (start < end) {
+        madvise((void*) start, end - start, MADV_DONTNEED);
+    }
+}
+
+// The pressure callbacks and the purge of free memory run again under the soft limit only once the footprint has
+// moved, or that many bytes have been freed, since they last ran: 1/SOFT_LIMIT_RELIEF_FRACTION of the limit.
+static constexpr size_t SOFT_LIMIT_RELIEF_FRACTION = 16;
+
+/// place_under_soft_limit(block_size, sz, alignment, file, line)
+///    Tries to place a block of 'block_size' bytes for an allocation of `sz` bytes aligned to 'alignment' without
+///    growing the heap's
+///    footprint, because growing it would exceed the soft limit. Calls the pressure callbacks and purges free memory
+///    first, unless they ran recently. Returns the payload pointer, or nullptr if the heap has to grow.
+static void* place_under_soft_limit(size_t block_size, size_t sz, size_t alignment, const char* file, int line) {
+    size_t footprint = get_footprint();
+    size_t distance = std::max(footprint, heap->soft_limit_relieved_footprint)
+        - std::min(footprint, heap->soft_limit_relieved_footprint);
+    unsigned long long freed_size = heap->stats.total_size - heap->stats.active_size;
+    size_t relief_distance = heap->buffer.soft_limit / SOFT_LIMIT_RELIEF_FRACTION;
+    if (distance >= relief_distance || freed_size - heap->soft_limit_relieved_freed_size >= relief_distance) {
+        heap->soft_limit_relieved_footprint = footprint;
+        heap->soft_limit_relieved_freed_size = freed_size;
+        relieve_pressure(sz);
+        purge_free_memory();
+        if (get_footprint() + block_size <= heap->buffer.soft_limit) {
+            return nullptr;
+        }
+    }
+
+    unsigned long long nfrees = heap->stats.ntotal - heap->stats.nactive;
+    if (nfrees == heap->soft_limit_failed_frees) {
+        return nullptr;
+    }
+    void* p_payload;
+    if (alignment > ALIGNMENT) {
+        p_payload = find_aligned_freed_block(alignment, block_size, sz, file, line);
+    } else {
+        p_payload = find_freed_block(block_size, sz, file, line, get_pos_block());
+    }
+    if (p_payload == nullptr) {
+        heap->soft_limit_failed_frees = nfrees;
+    }
+    return p_payload;
+}
+
+/// allocate_block(block_size, sz, hint, file, line, alignment)
+///    Allocates a block of 'block_size' bytes for an allocation of `sz` bytes whose payload is aligned to 'alignment'
+///    and returns its payload pointer, or nullptr on failure. `hint` is a combination of m61_lifetime_hint flags, or 0 to place the block according to
+///    the predicted lifetime of its site. The allocation request was made at source code location `file`:`line`.
+static void* allocate_block(size_t block_size, size_t sz, int hint, const char* file, int line,
+                            size_t alignment = ALIGNMENT) {
+    if (!(hint & (M61_SHORT_LIVED | M61_LONG_LIVED))) {
+        hint = predict_lifetime(file, line);
+    }
+
+    void* p_payload = nullptr;
+    if (heap->buffer.soft_limit && get_footprint() + block_size > heap->buffer.soft_limit) {
+        p_payload = place_under_soft_limit(block_size, sz, alignment, file, line);
+    }
+    if (p_payload == nullptr) {
+        p_payload = place_block(block_size, sz, hint, alignment, file, line);
     }
 
+    // Out of memory: let the pressure callbacks release memory and retry
+    if (p_payload == nullptr && relieve_pressure(sz)) {
+        p_payload = place_block(block_size, sz, hint, alignment, file, line);
+    }
+
+    // Fall back to the emergency reserve, which is outside the heap and not part of its bounds. Only the private
+    // heap uses it: other heaps are limited to their buffers, and may be destroyed or used by other processes.
+    if (p_payload == nullptr) {
+        if (heap == &default_heap) {
+            p_payload = reserve_alloc(sz, true, alignment);
+        }
+        if (p_payload == nullptr) {
+            update_statistics_for_failure(sz);
+            return nullptr;
+        }
+        ++heap->stats.ntotal;
+        ++heap->stats.nactive;
+        heap->stats.total_size += sz;
+        heap->stats.active_size += sz;
+        add_to_size_histogram(sz, 1);
+        update_peaks();
+        return p_payload;
+    }
+
+    add_to_statistics(sz, p_payload);
+
+    return p_payload;
+}
+
+/// m61_malloc(sz, p_file, line)
+///    Returns a pointer to `sz` bytes of freshly-allocated dynamic memory.
+///    The memory is not initialized. If `sz == 0`, then m61_malloc may
+///    return either `nullptr` or a pointer to a unique allocation.
+///    The allocation request was made at source code location `file`:`line`.
+void* m61_malloc(size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_MALLOC);
+    m61_heap_guard guard;
+
+    (void) file, (void) line;   // avoid uninitialized variable warnings
+
+    size_t block_size;
+    if (!get_block_size(sz, &block_size)) {
+        update_statistics_for_failure(sz);
+        return nullptr;
+    }
+
+    return allocate_block(block_size, sz, 0, file, line);
+}
+
+/// check_free(ptr, file, line)
+///    Validates a free of `ptr` requested at source code location `file`:`line` and returns the header pointer of the
+///    block. Prints an error and aborts if `ptr` is not an active allocation or if a wild write is detected.
+static header* check_free(void* ptr, const char* file, int line) {
     // Check whether ptr is a non-heap pointer
-    if ((uintptr_t) ptr < gstats.heap_min || (uintptr_t) ptr > gstats.heap_max) {
+    uintptr_t offset = get_heap_offset(ptr);
+    if (!heap->stats.heap_max || offset < heap->stats.heap_min || offset > heap->stats.heap_max) {
         fprintf(stderr, "MEMORY BUG: %s:%d: invalid free of pointer %p, not in heap\n", file, line, ptr);
         abort();
     }
@@ -444,14 +1531,14 @@ void m61_free(void* ptr, const char* file, int line) {
     header* p_header = ((header*) ptr) - 1;
 
     // Check if p_header is a valid header pointer
-    if (!is_header_valid(p_header, ptr)) {
+    if (!is_header_valid(p_header, ptr) || (p_header->status == ALLOCATED && !is_block_linked(p_header))) {
         fprintf(stderr, "MEMORY BUG: %s:%d: invalid free of pointer %p, not allocated\n", file, line, ptr);
         abort();
     }
 
     // Print errors if the block is not allocated
-    if (p_header->p_status != ALLOCATED) {
-        if (p_header->p_status == FREE) {
+    if (p_header->status != ALLOCATED) {
+        if (p_header->status == FREE) {
             fprintf(stderr, "MEMORY BUG: %s:%d: invalid free of pointer %p, double free\n", file, line, ptr);
         } else {
             fprintf(stderr, "MEMORY BUG: %s:%d: invalid free of pointer %p, not allocated\n", file, line, ptr);
@@ -466,18 +1553,335 @@ void m61_free(void* ptr, const char* file, int line) {
         abort();
     }
 
-    // Update the statistics
-    size_t payload_size = get_payload_size(p_header);
-    remove_from_statistics(payload_size);
+    return p_header;
+}
+
+/// free_block(p_header, file, line)
+///    Converts the allocated block pointed to by the given header pointer into a free block, coalesces it with its
+///    neighbors and moves the buffer position if possible. Does not update the statistics. The free was called at
+///    location `file`:`line`.
+static void free_block(header* p_header, const char* file, int line) {
+    record_site_free(p_header);
+    remove_from_mark_totals(p_header, p_header->block_size);
 
     // Free the block pointed to by p_header
     p_header = generate_free_block((void*) p_header, p_header->block_size, file, line);
+    add_free_space(p_header->block_size);
 
     // Try to coalesce and move the buffer position
     coalesce(p_header);
     move_buffer_pos();
 }
 
+/// release_block(p_header, payload_size, file, line)
+///    Frees the allocated block pointed to by the given header pointer, whose payload is 'payload_size' bytes long.
+///    The free was called at location `file`:`line`.
+static void release_block(header* p_header, size_t payload_size, const char* file, int line) {
+    // Update the statistics
+    remove_from_statistics(payload_size);
+
+    free_block(p_header, file, line);
+}
+
+/// m61_malloc_hint(sz, hint, p_file, line)
+///    Like `m61_malloc(sz, p_file, line)`, but `hint` tells how long the
+///    allocation is expected to live. M61_LONG_LIVED allocations are placed
+///    at the end of the default buffer, growing down, while short-lived
+///    allocations grow up from its start. Keeping survivors out of the
+///    short-lived region lets freed temporaries coalesce and return to the
+///    buffer position. Without a hint, the allocation is placed as its
+///    site's observed lifetimes predict.
+void* m61_malloc_hint(size_t sz, int hint, const char* file, int line) {
+    m61_latency_timer timer(OP_MALLOC);
+    m61_heap_guard guard;
+
+    size_t block_size;
+    if (!get_block_size(sz, &block_size)) {
+        update_statistics_for_failure(sz);
+        return nullptr;
+    }
+
+    return allocate_block(block_size, sz, hint, file, line);
+}
+
+/// m61_set_lifetime_prediction(enabled)
+///    Enables or disables lifetime prediction. While enabled (the default),
+///    unhinted allocations from a site whose blocks have mostly lived long
+///    are placed as if hinted M61_LONG_LIVED; sites with short lifetimes
+///    stay in the short-lived region. Lifetimes are recorded either way.
+void m61_set_lifetime_prediction(bool enabled) {
+    lifetime_prediction = enabled;
+}
+
+/// m61_set_latency_tracking(enabled)
+///    Enables or disables recording the latencies of m61_malloc, m61_free,
+///    m61_realloc, m61_calloc, m61_aligned_alloc, m61_malloc_batch,
+///    m61_free_batch and m61_arena_alloc calls, including their variants
+///    with hints and sizes, from all threads. Disabled by default. A
+///    recorded call costs two reads of the monotonic clock and a few atomic
+///    histogram updates, so tracking can be left enabled in production.
+void m61_set_latency_tracking(bool enabled) {
+    latency_tracking.store(enabled, std::memory_order_relaxed);
+}
+
+/// m61_free(ptr, p_file, line)
+///    Frees the memory allocation pointed to by `ptr`. If `ptr == nullptr`,
+///    does nothing. Otherwise, `ptr` must point to a currently active
+///    allocation returned by `m61_malloc`. The free was called at location
+///    `p_file`:`line`.
+void m61_free(void* ptr, const char* file, int line) {
+    m61_latency_timer timer(OP_FREE);
+    m61_heap_scope scope(get_owning_heap(ptr));
+    m61_heap_guard guard;
+
+    // avoid uninitialized variable warnings
+    (void) ptr, (void) file, (void) line;
+
+    if (ptr == nullptr) {
+        return;
+    } else if (is_reserve_pointer(ptr)) {
+        release_reserve_allocation(ptr);
+        return;
+    }
+
+    header* p_header = check_free(ptr, file, line);
+    release_block(p_header, get_payload_size(p_header), file, line);
+}
+
+/// m61_free_sized(ptr, sz, p_file, line)
+///    Like `m61_free`, but the caller also passes the size `sz` that was
+///    requested when `ptr` was allocated. The block is found from `ptr`
+///    alone, without the heap range and block list checks of `m61_free`.
+///    Without NDEBUG, a block that is not allocated gets the full checks and
+///    a mismatched size is reported as a memory bug. With NDEBUG, `ptr` and
+///    `sz` are trusted.
+void m61_free_sized(void* ptr, size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_FREE);
+    m61_heap_scope scope(get_owning_heap(ptr));
+    m61_heap_guard guard;
+
+    (void) file, (void) line;   // avoid uninitialized variable warnings
+
+    if (ptr == nullptr) {
+        return;
+    } else if (is_reserve_pointer(ptr)) {
+        release_reserve_allocation(ptr);
+        return;
+    }
+
+    header* p_header = ((header*) ptr) - 1;
+#ifndef NDEBUG
+    if (p_header->status != ALLOCATED) {
+        check_free(ptr, file, line);
+    }
+    size_t payload_size = get_payload_size(p_header);
+    if (sz != payload_size) {
+        fprintf(stderr, "MEMORY BUG: %s:%d: invalid free of pointer %p, size %zu does not match allocated size %zu\n",
+                file, line, ptr, sz, payload_size);
+        abort();
+    }
+#endif
+
+    release_block(p_header, sz, file, line);
+}
+
+/// m61_malloc_block(block_size, sz, p_file, line)
+///    Like `m61_malloc(sz, p_file, line)`, but `block_size` must be
+///    `m61_block_size(sz)`, which callers with a constant `sz` compute at
+///    compile time. Skips the padding and overflow computations.
+void* m61_malloc_block(size_t block_size, size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_MALLOC);
+    m61_heap_guard guard;
+    return allocate_block(block_size, sz, 0, file, line);
+}
+
+/// m61_malloc_usable_size(ptr)
+///    Returns the payload size of the active allocation pointed to by `ptr`,
+///    or 0 if `ptr == nullptr`. The pointer is not validated.
+size_t m61_malloc_usable_size(void* ptr) {
+    if (ptr == nullptr) {
+        return 0;
+    } else if (is_reserve_pointer(ptr)) {
+        return ((m61_reserve_header*) ptr)[-1].size;
+    }
+    return get_payload_size(((header*) ptr) - 1);
+}
+
+/// m61_malloc_batch(sz, n, ptrs, p_file, line)
+///    Allocates `n` blocks of `sz` bytes each and stores their pointers in
+///    `ptrs[0]` through `ptrs[n - 1]`. The block size is computed once, as
+///    many blocks as fit (under the soft limit, if any) are carved from the
+///    default buffer in one pass, and the statistics are updated once for
+///    those blocks. The rest reuse freed blocks or take the slow path of
+///    `m61_malloc`, with its pressure callbacks and emergency reserve.
+///    Returns the number of blocks allocated; if it is less than `n`, the
+///    remaining entries of `ptrs` are set to `nullptr` and count as failed
+///    allocations. The allocation request was made at source code location
+///    `file`:`line`.
+size_t m61_malloc_batch(size_t sz, size_t n, void** ptrs, const char* file, int line) {
+    m61_latency_timer timer(OP_MALLOC_BATCH);
+    m61_heap_guard guard;
+
+    size_t count = 0;
+    uintptr_t min_addr = UINTPTR_MAX;
+    uintptr_t max_addr = 0;
+    bool failure_counted = false;   // whether allocate_block counted the failure of ptrs[count]
+
+    size_t block_size;
+    if (get_block_size(sz, &block_size) && heap->buffer.map()) {
+        // Carve as many blocks as possible from the default buffer
+        size_t room = heap->buffer.end - heap->buffer.pos;
+        if (heap->buffer.soft_limit) {
+            size_t footprint = get_footprint();
+            room = std::min(room, footprint < heap->buffer.soft_limit ? heap->buffer.soft_limit - footprint : 0);
+        }
+        size_t nbuffer = room / block_size;
+        if (nbuffer > n) {
+            nbuffer = n;
+        }
+        for (; count != nbuffer; ++count) {
+            void* ptr = &heap->buffer.buffer[heap->buffer.pos];
+            header* p_header = generate_alloc_block(ptr, block_size, sz, file, line);
+            add_pos_block(p_header);
+            heap->buffer.pos += block_size;
+            ptrs[count] = p_header->p_payload;
+        }
+        if (count) {
+            min_addr = (uintptr_t) ptrs[0];
+            max_addr = (uintptr_t) ptrs[count - 1] + sz;
+        }
+
+        // Then fall back to the freed blocks
+        for (; count != n; ++count) {
+            ptrs[count] = find_freed_block(block_size, sz, file, line, get_pos_block());
+            if (!ptrs[count]) {
+                break;
+            }
+            if (min_addr > (uintptr_t) ptrs[count]) {
+                min_addr = (uintptr_t) ptrs[count];
+            }
+            if (max_addr < (uintptr_t) ptrs[count] + sz) {
+                max_addr = (uintptr_t) ptrs[count] + sz;
+            }
+        }
+
+        if (count) {
+            add_batch_to_statistics(count, sz, min_addr, max_addr);
+        }
+
+        // Allocate the rest one by one, which relieves pressure and updates the statistics
+        for (; count != n; ++count) {
+            ptrs[count] = allocate_block(block_size, sz, 0, file, line);
+            if (!ptrs[count]) {
+                failure_counted = true;
+                break;
+            }
+        }
+    }
+
+    for (size_t i = count; i != n; ++i) {
+        ptrs[i] = nullptr;
+        if (i != count || !failure_counted) {
+            update_statistics_for_failure(sz);
+        }
+    }
+
+    return count;
+}
+
+/// m61_free_batch(ptrs, n, p_file, line)
+///    Frees the `n` allocations pointed to by `ptrs[0]` through
+///    `ptrs[n - 1]`. Null entries are skipped. Every pointer is checked as
+///    in `m61_free`, but the statistics are updated once for the whole batch.
+///    Blocks are released from the last entry to the first, so a batch
+///    returned by `m61_malloc_batch` is handed straight back to the buffer.
+///    The free was called at location `file`:`line`.
+void m61_free_batch(void** ptrs, size_t n, const char* file, int line) {
+    m61_latency_timer timer(OP_FREE_BATCH);
+    m61_heap_guard guard;
+
+    size_t count = 0;
+    size_t size = 0;
+
+    for (size_t i = n; i != 0; --i) {
+        void* ptr = ptrs[i - 1];
+        if (ptr == nullptr) {
+            continue;
+        } else if (get_owning_heap(ptr) != heap) {
+            m61_free(ptr, file, line);
+            continue;
+        } else if (is_reserve_pointer(ptr)) {
+            release_reserve_allocation(ptr);
+            continue;
+        }
+        header* p_header = check_free(ptr, file, line);
+        size_t payload_size = get_payload_size(p_header);
+        ++count;
+        size += payload_size;
+        remove_from_size_histogram(payload_size);
+        free_block(p_header, file, line);
+    }
+
+    heap->stats.nactive -= count;
+    heap->stats.active_size -= size;
+}
+
+/// m61_aligned_alloc(alignment, sz, p_file, line)
+///    Returns a pointer to `sz` bytes of freshly-allocated dynamic memory
+///    whose address is a multiple of `alignment`. `alignment` must be a
+///    power of two; otherwise returns `nullptr`. The returned pointer can be
+///    passed to `m61_free` and `m61_realloc` like any other allocation.
+///    Like `m61_malloc`, it may relieve pressure, respects the soft limit
+///    and falls back to the emergency reserve for alignments up to 1 KiB.
+///    The allocation request was made at source code location `file`:`line`.
+void* m61_aligned_alloc(size_t alignment, size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_ALIGNED_ALLOC);
+    m61_heap_guard guard;
+
+    if (!is_power_of_two(alignment)) {
+        update_statistics_for_failure(sz);
+        return nullptr;
+    }
+
+    // Every block is already aligned to ALIGNMENT
+    if (alignment <= ALIGNMENT) {
+        return m61_malloc(sz, file, line);
+    }
+
+    size_t block_size;
+    if (!get_block_size(sz, &block_size)) {
+        update_statistics_for_failure(sz);
+        return nullptr;
+    }
+
+    return allocate_block(block_size, sz, 0, file, line, alignment);
+}
+
+/// m61_posix_memalign(p_ptr, alignment, sz, p_file, line)
+///    Like m61_aligned_alloc, but stores the allocation in `*p_ptr` and
+///    returns 0 on success. Returns EINVAL if `alignment` is not a power of
+///    two multiple of `sizeof(void*)`, and ENOMEM if out of memory; `*p_ptr`
+///    is left unchanged on failure.
+int m61_posix_memalign(void** p_ptr, size_t alignment, size_t sz, const char* file, int line) {
+    if (!is_power_of_two(alignment) || alignment % sizeof(void*) != 0) {
+        return EINVAL;
+    }
+
+    void* ptr = m61_aligned_alloc(alignment, sz, file, line);
+    if (ptr == nullptr) {
+        return ENOMEM;
+    }
+
+    *p_ptr = ptr;
+    return 0;
+}
+
+/// m61_memalign(alignment, sz, p_file, line)
+///    Same as m61_aligned_alloc.
+void* m61_memalign(size_t alignment, size_t sz, const char* file, int line) {
+    return m61_aligned_alloc(alignment, sz, file, line);
+}
+
 /// m61_calloc(count, sz, p_file, line)
 ///    Returns a pointer a fresh dynamic memory allocation big enough to
 ///    hold an array of `count` elements of `sz` bytes each. Returned
@@ -485,9 +1889,12 @@ void m61_free(void* ptr, const char* file, int line) {
 ///    location `p_file`:`line`. Returns `nullptr` if out of memory; may
 ///    also return `nullptr` if `count == 0` or `size == 0`.
 void* m61_calloc(size_t count, size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_CALLOC);
+    m61_heap_guard guard;
+
     if (is_overflowing(count, sz)) {
-        gstats.fail_size += sz ;
-        ++gstats.nfail;
+        heap->stats.fail_size += sz ;
+        ++heap->stats.nfail;
         return nullptr;
     }
 
@@ -498,72 +1905,1270 @@ void* m61_calloc(size_t count, size_t sz, const char* file, int line) {
     return ptr;
 }
 
-/// m61_get_statistics()
-///    Return the current memory statistics.
-m61_statistics m61_get_statistics() {
-    return gstats;
-}
+/// m61_arena_chunk
+///    Header of a chunk of arena memory. The chunk's data follows the header.
+struct alignas(alignof(std::max_align_t)) m61_arena_chunk {
+    m61_arena_chunk* p_next;   // next chunk of the arena
+    size_t size;               // size of the chunk's data
+};
 
-/// m61_print_statistics()
-///    Prints the current memory statistics.
-void m61_print_statistics() {
-    m61_statistics stats = m61_get_statistics();
-    printf("alloc count: active %10llu   total %10llu   fail %10llu\n",
-           stats.nactive, stats.ntotal, stats.nfail);
-    printf("alloc size:  active %10llu   total %10llu   fail %10llu\n",
-           stats.active_size, stats.total_size, stats.fail_size);
+/// m61_arena
+///    Arena state. 'p_chunk' is the chunk that allocations are bumped from; larger allocations get chunks of their
+///    own, which are linked in after it.
+struct m61_arena {
+    m61_arena_chunk* p_chunk;  // current chunk, followed by all other chunks
+    size_t pos;                // bump position in the current chunk
+    size_t chunk_size;         // data size of a regular chunk
+};
+
+/// allocate_arena_chunk(p_arena, size, file, line)
+///    Allocates a chunk with 'size' bytes of data from the heap and links it into the arena after the current chunk,
+///    or as the current chunk if 'p_arena' has none. Returns the chunk pointer, or nullptr if out of memory.
+static m61_arena_chunk* allocate_arena_chunk(m61_arena* p_arena, size_t size, const char* file, int line) {
+    if (size > SIZE_MAX - sizeof(m61_arena_chunk)) {
+        update_statistics_for_failure(size);
+        return nullptr;
+    }
+
+    auto p_chunk = (m61_arena_chunk*) m61_malloc(sizeof(m61_arena_chunk) + size, file, line);
+    if (p_chunk == nullptr) {
+        return nullptr;
+    }
+    p_chunk->size = size;
+
+    if (p_arena->p_chunk) {
+        p_chunk->p_next = p_arena->p_chunk->p_next;
+        p_arena->p_chunk->p_next = p_chunk;
+    } else {
+        p_chunk->p_next = nullptr;
+        p_arena->p_chunk = p_chunk;
+    }
+    return p_chunk;
 }
 
-/// m61_print_leak_report()
-///    Prints a report of all currently-active allocated blocks of dynamic memory.
-void m61_print_leak_report() {
-    header* p_header = head;
-    // Traverse the linked list
-    while (p_header) {
-        // Print to stdout if the block is allocated
-        if (p_header->p_status == ALLOCATED) {
-            size_t payload_size = get_payload_size(p_header);
-            fprintf(stdout, "LEAK CHECK: %s:%d: allocated object %p with size %zu\n", p_header->p_file, p_header->line,
-                    p_header->p_payload, payload_size);
-        }
-        p_header = p_header->p_next;
+/// free_arena_chunks(p_chunk, file, line)
+///    Frees the given chunk and all chunks after it.
+static void free_arena_chunks(m61_arena_chunk* p_chunk, const char* file, int line) {
+    while (p_chunk) {
+        m61_arena_chunk* p_next = p_chunk->p_next;
+        m61_free_sized(p_chunk, sizeof(m61_arena_chunk) + p_chunk->size, file, line);
+        p_chunk = p_next;
     }
 }
 
-/// m61_realloc(ptr, sz, p_file, line)
-///    Changes the size of the dynamic allocation pointed to by `ptr`
-///    to hold at least `sz` bytes. If the existing allocation cannot be
-///    enlarged, this function makes a new allocation, copies as much data
-///    as possible from the old allocation to the new, and returns a pointer
-///    to the new allocation. If `ptr` is `nullptr`, behaves like
-///    `m61_malloc(sz, p_file, line). `sz` must not be 0. If a required
-///    allocation fails, returns `nullptr` without freeing the original
-///    block.
-void* m61_realloc(void* ptr, size_t sz, const char* file, int line) {
-    (void) file, (void) line;   // avoid uninitialized variable warnings
+/// m61_arena_create(chunk_size, p_file, line)
+///    Creates an arena that hands out memory from chunks of `chunk_size`
+///    bytes obtained with `m61_malloc`. The chunks are active allocations,
+///    so they show up in the statistics, and in the leak report if the
+///    arena is never destroyed. Returns `nullptr` if out of memory. The
+///    request was made at source code location `file`:`line`.
+m61_arena* m61_arena_create(size_t chunk_size, const char* file, int line) {
+    auto p_arena = (m61_arena*) m61_malloc(sizeof(m61_arena), file, line);
+    if (p_arena == nullptr) {
+        return nullptr;
+    }
 
-    if (!sz){
+    p_arena->p_chunk = nullptr;
+    p_arena->pos = 0;
+    p_arena->chunk_size = chunk_size ? chunk_size : 1;
+    if (!allocate_arena_chunk(p_arena, p_arena->chunk_size, file, line)) {
+        m61_free(p_arena, file, line);
         return nullptr;
     }
+    return p_arena;
+}
 
-    void* new_ptr = m61_malloc(sz, file, line);
+/// m61_arena_alloc(p_arena, sz, p_file, line)
+///    Returns a pointer to `sz` bytes of memory from the arena, aligned like
+///    `m61_malloc`'s. Allocation is a pointer bump in the current chunk; a new
+///    chunk is taken from the heap when it is full, and allocations larger
+///    than the chunk size get a chunk of their own. Arena memory cannot be
+///    passed to `m61_free`. Returns `nullptr` if out of memory.
+void* m61_arena_alloc(m61_arena* p_arena, size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_ARENA_ALLOC);
+    m61_heap_guard guard;
+
+    size_t aligned_sz = sz + (ALIGNMENT - sz % ALIGNMENT) % ALIGNMENT;
+    if (aligned_sz < sz) {
+        update_statistics_for_failure(sz);
+        return nullptr;
+    }
 
-    if (!ptr || !new_ptr) {
-        return new_ptr;
+    // Bump the current chunk
+    m61_arena_chunk* p_chunk = p_arena->p_chunk;
+    if (p_chunk->size - p_arena->pos >= aligned_sz) {
+        void* ptr = (char*) (p_chunk + 1) + p_arena->pos;
+        p_arena->pos += aligned_sz;
+        return ptr;
     }
 
-    // Retrieve the header pointer and payload size of the new block
-    header* p_header = ((header*) new_ptr) - 1;
-    size_t payload_size = get_payload_size(p_header);
+    // Large allocations get a chunk of their own
+    if (aligned_sz > p_arena->chunk_size) {
+        p_chunk = allocate_arena_chunk(p_arena, aligned_sz, file, line);
+        return p_chunk ? (void*) (p_chunk + 1) : nullptr;
+    }
 
-    // Copy the whole payload if 'sz' is larger than the payload. Otherwise, copy only 'sz' bytes
-    if (sz > payload_size) {
-        memcpy(new_ptr, ptr, payload_size);
-    } else {
-        memcpy(new_ptr, ptr, sz);
+    // Otherwise start a new current chunk
+    m61_arena_chunk* p_old_chunk = p_arena->p_chunk;
+    p_arena->p_chunk = nullptr;
+    p_chunk = allocate_arena_chunk(p_arena, p_arena->chunk_size, file, line);
+    if (p_chunk == nullptr) {
+        p_arena->p_chunk = p_old_chunk;
+        return nullptr;
     }
+    p_chunk->p_next = p_old_chunk;
+    p_arena->pos = aligned_sz;
+    return p_chunk + 1;
+}
 
-    m61_free(ptr, file, line);
+/// m61_arena_reset(p_arena, p_file, line)
+///    Releases all memory allocated from the arena at once. The current
+///    chunk is kept for reuse and all other chunks are returned to the heap.
+void m61_arena_reset(m61_arena* p_arena, const char* file, int line) {
+    free_arena_chunks(p_arena->p_chunk->p_next, file, line);
+    p_arena->p_chunk->p_next = nullptr;
+    p_arena->pos = 0;
+}
 
-    return new_ptr;
-}
\ No newline at end of file
+/// m61_arena_destroy(p_arena, p_file, line)
+///    Releases all memory allocated from the arena and the arena itself.
+///    Does nothing if `p_arena == nullptr`.
+void m61_arena_destroy(m61_arena* p_arena, const char* file, int line) {
+    if (p_arena == nullptr) {
+        return;
+    }
+    free_arena_chunks(p_arena->p_chunk, file, line);
+    m61_free_sized(p_arena, sizeof(m61_arena), file, line);
+}
+
+/// m61_mark()
+///    Returns a checkpoint of the heap: the current position of the default
+///    buffer. Allocations made until the mark is released bump up from that
+///    position. Marks nest like a stack.
+m61_checkpoint m61_mark() {
+    m61_heap_guard guard;
+    if (mark_depth < MAX_MARK_DEPTH) {
+        m61_mark_totals& totals = mark_totals[mark_depth];
+        totals = {};
+        totals.p_heap = heap;
+        totals.ntotal = heap->stats.ntotal;
+    }
+    return {heap->buffer.pos, heap->stats.ntotal, mark_depth++, mark_noutside};
+}
+
+/// is_allocated_since(p_header, mark)
+///    Returns true if the block pointed to by the given header pointer is allocated and was allocated after `mark`
+///    was taken.
+static bool is_allocated_since(header* p_header, const m61_checkpoint& mark) {
+    uint32_t nallocs = (uint32_t) (heap->stats.ntotal - mark.ntotal);
+    return p_header->status == ALLOCATED && (uint32_t) (p_header->alloc_clock - (uint32_t) mark.ntotal) < nallocs;
+}
+
+/// unlink_released_blocks(p_header, pos)
+///    Unlinks the blocks at the buffer position above the block pointed to by the given header pointer, which stays,
+///    at once, and moves the buffer position back to `pos`, where they start.
+static void unlink_released_blocks(header* p_header, size_t pos) {
+    if (p_header) {
+        p_header->p_prev = heap->top_block;
+    }
+    if (heap->top_block) {
+        heap->top_block->p_next = p_header;
+    } else {
+        heap->head = p_header;
+    }
+    heap->buffer.pos = pos;
+    move_buffer_pos();
+}
+
+/// record_mark_site_frees(mark_site)
+///    Records the frees of the allocations from one site that a mark tracks, as record_site_free does for a block.
+static void record_mark_site_frees(const m61_mark_site& mark_site) {
+    m61_site& site = sites[mark_site.site];
+    if (mark_site.nactive == 0 || site.nactive == 0) {
+        return;
+    }
+    site.nactive -= std::min(mark_site.nactive, site.nactive);
+    site.active_size -= std::min(mark_site.active_size, site.active_size);
+
+    unsigned long long total_lifetime = mark_site.nactive * (uint32_t) heap->stats.ntotal - mark_site.clock_sum;
+    unsigned long long lifetime = total_lifetime / mark_site.nactive;
+    site.total_lifetime += total_lifetime;
+    if (site.nfrees == 0) {
+        site.mean_lifetime = lifetime;
+    }
+    // The moving average has forgotten older lifetimes after a few dozen equal ones
+    for (unsigned long long i = 0; i != std::min(mark_site.nactive, 64ULL); ++i) {
+        site.mean_lifetime = site.mean_lifetime - site.mean_lifetime / 8 + lifetime / 8;
+    }
+    site.nfrees += mark_site.nactive;
+}
+
+/// release_tracked_blocks(mark)
+///    Releases the blocks allocated since `mark` by subtracting the totals of `mark` and the marks taken after it
+///    from the statistics, without visiting the blocks. Returns false, releasing nothing, unless the totals cover
+///    exactly the blocks above the mark: allocations were placed elsewhere, blocks above the mark were freed without
+///    moving the buffer position back, or the position went below the mark.
+static bool release_tracked_blocks(const m61_checkpoint& mark) {
+    if (mark_depth > MAX_MARK_DEPTH || mark_noutside != mark.noutside || heap->buffer.pos < mark.pos) {
+        return false;
+    }
+    size_t block_size = 0;
+    for (unsigned i = mark.depth; i != mark_depth; ++i) {
+        if (mark_totals[i].p_heap != heap || mark_totals[i].untracked) {
+            return false;
+        }
+        block_size += mark_totals[i].block_size;
+    }
+    if (heap->buffer.pos - mark.pos != block_size) {
+        return false;
+    }
+
+    for (unsigned i = mark.depth; i != mark_depth; ++i) {
+        const m61_mark_totals& totals = mark_totals[i];
+        heap->stats.nactive -= totals.nactive;
+        heap->stats.active_size -= totals.active_size;
+        for (int size_class = 0; size_class != M61_NSIZE_CLASSES; ++size_class) {
+            heap->sizes.nactive[size_class] -= totals.size_nactive[size_class];
+            heap->sizes.active_size[size_class] -= totals.size_active_size[size_class];
+        }
+        for (size_t j = 0; j != totals.nsites; ++j) {
+            record_mark_site_frees(totals.sites[j]);
+        }
+    }
+
+    // The lowest released block starts at the mark
+    if (block_size != 0) {
+        unlink_released_blocks(((header*) &heap->buffer.buffer[mark.pos])->p_next, mark.pos);
+    }
+    return true;
+}
+
+/// m61_release(mark, p_file, line)
+///    Frees every allocation made since `mark` by moving the buffer position
+///    back to it, and releases `mark` together with all marks taken after
+///    it. The blocks are dropped without being freed one by one: running
+///    totals kept since the mark are subtracted from the statistics, so the
+///    release takes constant time however many blocks it drops. Only if
+///    blocks were freed above the mark, or the marks nest more than 16
+///    deep, are the released blocks visited. Allocations made since the
+///    mark outside of the released part of the buffer, such as long-lived
+///    allocations, are not freed and are reported in debug builds. The
+///    release was called at location `file`:`line`.
+void m61_release(const m61_checkpoint& mark, const char* file, int line) {
+    m61_heap_guard guard;
+
+    if (mark.depth >= mark_depth) {
+        fprintf(stderr, "MEMORY BUG: %s:%d: invalid release of a mark that is not active\n", file, line);
+        abort();
+    }
+
+    // If the mark totals do not cover the released blocks, walk them: drop the blocks at the buffer position that
+    // were allocated after the mark, or that end above it. The buffer position may have gone below the mark in the
+    // meantime, when blocks allocated before it were freed, so such blocks may start below the mark. Free blocks
+    // between them are dropped too.
+    if (!release_tracked_blocks(mark)) {
+        header* p_header = get_pos_block();
+        size_t pos = heap->buffer.pos;
+        while (p_header && ((char*) p_header + p_header->block_size > heap->buffer.buffer + mark.pos
+                            || p_header->status == FREE || is_allocated_since(p_header, mark))) {
+            if (p_header->status == ALLOCATED) {
+                remove_from_statistics(get_payload_size(p_header));
+                record_site_free(p_header);
+                remove_from_mark_totals(p_header, p_header->block_size);
+            } else {
+                remove_free_space(p_header->block_size);
+            }
+            pos = (char*) p_header - heap->buffer.buffer;
+            p_header = p_header->p_next;
+        }
+        unlink_released_blocks(p_header, pos);
+    }
+    mark_depth = mark.depth;
+
+#ifndef NDEBUG
+    // Report allocations made since the mark that were placed elsewhere. Only allocations counted in mark_noutside
+    // can be, so the heap is only searched if there are any.
+    if (mark_noutside != mark.noutside) {
+        for (header* p = heap->head; p; p = p->p_next) {
+            if (is_allocated_since(p, mark)) {
+                fprintf(stderr,
+                        "MARK CHECK: %s:%d: allocated object %p with size %zu escapes the mark released at %s:%d\n",
+                        get_block_file(p), get_block_line(p), p->p_payload.get(), get_payload_size(p), file, line);
+            }
+        }
+    }
+#endif
+}
+
+// Identifier at the start of a shared heap object
+const uint64_t SHARED_HEAP_MAGIC = 0x6D36315348415245ULL;
+
+/// m61_shared_control
+///    Control block at the start of a shared or persistent heap object, followed by the heap's buffer. The heap's
+///    links are offset pointers, so each process may map the object at a different address.
+struct alignas(alignof(std::max_align_t)) m61_shared_control {
+    uint64_t magic;             // SHARED_HEAP_MAGIC
+    size_t size;                // size of the object
+    uintptr_t address;          // address of the mapping in the process that created it, preferred by the others
+    int open;                   // whether a persistent heap is open, so it was not closed cleanly if it is reopened
+    m61_offset_ptr<void> p_root;    // root pointer of a persistent heap
+    pthread_mutex_t lock;       // process-shared lock of the heap
+    m61_heap heap;
+};
+
+/// init_shared_lock(p_lock)
+///    Initializes the process-shared lock of a shared or persistent heap. The lock is recursive and robust: a process
+///    that dies holding it does not block the others forever.
+static void init_shared_lock(pthread_mutex_t* p_lock) {
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+    pthread_mutex_init(p_lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+}
+
+/// init_shared_heap(ptr, size)
+///    Creates an empty heap in the `size` bytes long shared mapping at 'ptr' and returns its control block.
+static m61_shared_control* init_shared_heap(void* ptr, size_t size) {
+    auto p_control = new (ptr) m61_shared_control;
+    p_control->magic = SHARED_HEAP_MAGIC;
+    p_control->size = size;
+    p_control->address = (uintptr_t) ptr;
+    p_control->open = 0;
+    p_control->p_root = nullptr;
+    init_shared_lock(&p_control->lock);
+
+    p_control->heap.buffer.buffer = (char*) (p_control + 1);
+    p_control->heap.buffer.size = size - sizeof(m61_shared_control);
+    p_control->heap.buffer.end = p_control->heap.buffer.size;
+    p_control->heap.p_lock = &p_control->lock;
+    return p_control;
+}
+
+/// map_shared_heap(fd)
+///    Maps the heap object `fd` and returns its control block, or nullptr if `fd` is not a heap object. The object is
+///    mapped at the address recorded in its control block if that is free, so that plain pointers stored in the heap
+///    by the application stay valid, and anywhere else otherwise.
+static m61_shared_control* map_shared_heap(int fd) {
+    uint64_t magic;
+    size_t size;
+    uintptr_t address;
+    if (pread(fd, &magic, sizeof(magic), offsetof(m61_shared_control, magic)) != sizeof(magic)
+        || magic != SHARED_HEAP_MAGIC
+        || pread(fd, &size, sizeof(size), offsetof(m61_shared_control, size)) != sizeof(size)
+        || pread(fd, &address, sizeof(address), offsetof(m61_shared_control, address)) != sizeof(address)) {
+        errno = EINVAL;
+        return nullptr;
+    }
+
+    void* ptr = mmap((void*) address, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+    return (m61_shared_control*) ptr;
+}
+
+/// get_shared_control()
+///    Returns the control block of the current heap, or nullptr if it is the private heap.
+static m61_shared_control* get_shared_control() {
+    if (heap == &default_heap) {
+        return nullptr;
+    }
+    return (m61_shared_control*) ((char*) heap - offsetof(m61_shared_control, heap));
+}
+
+/// m61_shared_heap_create(name, size)
+///    Creates a heap of `size` bytes in a POSIX shared memory object called
+///    `name`, or in an anonymous memfd if `name == nullptr`, and makes it the
+///    heap of the m61_malloc family. Returns a file descriptor for the
+///    object, which other processes pass to `m61_shared_heap_attach`, or -1
+///    on failure. Children forked afterwards use the shared heap directly.
+///    Allocations made from the private heap before are still freed and
+///    reallocated in the private heap.
+int m61_shared_heap_create(const char* name, size_t size) {
+    if (size <= sizeof(m61_shared_control) + MIN_BLOCK_SIZE) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    int fd = name ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600) : memfd_create("m61", 0);
+    if (fd < 0) {
+        return -1;
+    }
+    void* ptr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    if (ptr == MAP_FAILED) {
+        close(fd);
+        if (name) {
+            shm_unlink(name);
+        }
+        return -1;
+    }
+
+    heap = process_heap = &init_shared_heap(ptr, size)->heap;
+    return fd;
+}
+
+/// m61_shared_heap_attach(fd)
+///    Maps the shared heap object `fd`, created by `m61_shared_heap_create`
+///    in another process, and makes it the heap of the m61_malloc family.
+///    The object is mapped at the same address as in that process if it is
+///    free here, and anywhere else otherwise; the heap's own links do not
+///    depend on the address. Returns false if `fd` is not a shared heap.
+bool m61_shared_heap_attach(int fd) {
+    m61_shared_control* p_control = map_shared_heap(fd);
+    if (p_control == nullptr) {
+        return false;
+    }
+    heap = process_heap = &p_control->heap;
+    return true;
+}
+
+/// m61_shared_heap_detach()
+///    Unmaps the current shared heap and makes the m61_malloc family use the
+///    process's private heap again. Allocations in the shared heap become
+///    inaccessible to this process but stay valid for the others. Does
+///    nothing if no shared heap is in use.
+void m61_shared_heap_detach() {
+    m61_shared_control* p_control = get_shared_control();
+    if (p_control == nullptr) {
+        return;
+    }
+    heap = process_heap = &default_heap;
+    munmap(p_control, p_control->size);
+}
+
+/// check_persistent_heap(p_control)
+///    Returns true if the block list of the persistent heap with the given control block is consistent: every block
+///    is in the buffer, has a valid status and is linked both ways. A heap that was not closed cleanly may fail the
+///    check.
+static bool check_persistent_heap(m61_shared_control* p_control) {
+    m61_memory_buffer& buffer = p_control->heap.buffer;
+    header* p_prev = nullptr;
+    for (header* p = p_control->heap.head; p; p_prev = p, p = p->p_next) {
+        if ((char*) p < buffer.buffer || (char*) p + MIN_BLOCK_SIZE > buffer.buffer + buffer.size
+            || (p->status != FREE && p->status != ALLOCATED) || p->p_prev != p_prev
+            || (p_prev && p >= p_prev)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// m61_persistent_heap_open(path, size)
+///    Opens the persistent heap in the file at `path` and makes it the heap
+///    of the m61_malloc family. If the file does not exist, it is created
+///    with room for `size` bytes. Otherwise, its allocations and root
+///    pointer are recovered. As with a shared heap, allocations made from
+///    the private heap before are still freed in it. The heap is mapped at
+///    the address it was created at if that is free, and anywhere else
+///    otherwise, so links between allocations should be m61_offset_ptrs.
+///    Returns false on failure, including if the heap was not closed
+///    cleanly and its block list is inconsistent.
+bool m61_persistent_heap_open(const char* path, size_t size) {
+    if (get_shared_control()) {
+        errno = EBUSY;
+        return false;
+    }
+    int fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    m61_shared_control* p_control;
+    if (st.st_size == 0) {
+        void* ptr = MAP_FAILED;
+        if (size > sizeof(m61_shared_control) + MIN_BLOCK_SIZE && ftruncate(fd, size) == 0) {
+            ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        p_control = ptr == MAP_FAILED ? nullptr : init_shared_heap(ptr, size);
+    } else {
+        p_control = map_shared_heap(fd);
+    }
+    close(fd);
+    if (p_control == nullptr) {
+        return false;
+    }
+
+    // After a crash, the list may be half-updated and the lock may still be held by a process that is gone. A heap
+    // that was closed cleanly is used as is: its blocks are not touched, because each is tagged with the image of the
+    // process that allocated it, and their source locations are only read in that image.
+    if (st.st_size != 0 && p_control->open) {
+        if (!check_persistent_heap(p_control)) {
+            munmap(p_control, p_control->size);
+            errno = EIO;
+            return false;
+        }
+        init_shared_lock(&p_control->lock);
+    }
+    p_control->open = 1;
+    heap = process_heap = &p_control->heap;
+    return true;
+}
+
+/// m61_persistent_heap_close()
+///    Writes the persistent heap back to its file, unmaps it and makes the
+///    m61_malloc family use the process's private heap again.
+void m61_persistent_heap_close() {
+    m61_shared_control* p_control = get_shared_control();
+    if (p_control == nullptr) {
+        return;
+    }
+    p_control->open = 0;
+    msync(p_control, p_control->size, MS_SYNC);
+    m61_shared_heap_detach();
+}
+
+/// m61_set_root(ptr), m61_get_root()
+///    Sets or returns the root pointer of the current persistent heap, from
+///    which the application finds its data after reopening the heap.
+void m61_set_root(void* ptr) {
+    if (m61_shared_control* p_control = get_shared_control()) {
+        p_control->p_root = ptr;
+    }
+}
+
+void* m61_get_root() {
+    m61_shared_control* p_control = get_shared_control();
+    return p_control ? p_control->p_root.get() : nullptr;
+}
+
+// Identifier at the start of a heap snapshot file
+const uint64_t SNAPSHOT_MAGIC = 0x6D3631534E415032ULL;
+
+/// m61_snapshot_header
+///    Metadata at the start of a heap snapshot file. It is followed, at the next page boundary, by the low part of the
+///    buffer, [0, low_size), and then by its high part, [high_offset, size). Both parts are page-aligned so they can be
+///    mapped straight from the file. The used entries of the site table follow them.
+struct m61_snapshot_header {
+    uint64_t magic;             // SNAPSHOT_MAGIC
+    uintptr_t address;          // address of the buffer
+    size_t size;                // size of the buffer
+    size_t pos;                 // buffer position
+    size_t end;                 // start of the long-lived region
+    size_t low_size;            // size of the saved low part of the buffer
+    size_t high_offset;         // start of the saved high part of the buffer
+    header* head;
+    header* top_block;
+    m61_statistics stats;
+    m61_free_space free_space;
+    uintptr_t image;            // address of PREVIOUS_RUN in the process that wrote the snapshot
+    size_t nsites;              // # saved site table entries
+};
+
+/// m61_snapshot_site
+///    Entry of the site table saved in a heap snapshot.
+struct m61_snapshot_site {
+    uint32_t id;
+    m61_site site;
+};
+
+// Number of site table entries written or read at once
+const size_t SNAPSHOT_SITE_BATCH = 64;
+
+/// write_fully(fd, ptr, sz)
+///    Writes `sz` bytes from 'ptr' to file descriptor `fd`. Returns false on failure.
+static bool write_fully(int fd, const void* ptr, size_t sz) {
+    while (sz != 0) {
+        ssize_t n = write(fd, ptr, sz);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n <= 0) {
+            return false;
+        }
+        ptr = (const char*) ptr + n;
+        sz -= n;
+    }
+    return true;
+}
+
+/// m61_snapshot(path)
+///    Writes the used parts of the private heap and its metadata to the
+///    file at `path`, so that `m61_restore` can map them back later, for
+///    example in a new process. Returns false on failure or if a shared or
+///    persistent heap is in use.
+bool m61_snapshot(const char* path) {
+    if (heap != &default_heap || !heap->buffer.map()) {
+        errno = EINVAL;
+        return false;
+    }
+
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    m61_memory_buffer& buffer = heap->buffer;
+    m61_snapshot_header snapshot = {};
+    snapshot.magic = SNAPSHOT_MAGIC;
+    snapshot.address = (uintptr_t) buffer.buffer.get();
+    snapshot.size = buffer.size;
+    snapshot.pos = buffer.pos;
+    snapshot.end = buffer.end;
+    snapshot.low_size = std::min((buffer.pos + page_size - 1) / page_size * page_size, buffer.size);
+    snapshot.high_offset = std::max(buffer.end / page_size * page_size, snapshot.low_size);
+    snapshot.head = heap->head;
+    snapshot.top_block = heap->top_block;
+    snapshot.stats = heap->stats;
+    snapshot.free_space = heap->free_space;
+    snapshot.image = (uintptr_t) PREVIOUS_RUN;
+    for (uint32_t i = 0; i != SITE_CAPACITY; ++i) {
+        snapshot.nsites += sites[i].p_file != nullptr;
+    }
+
+    int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = write_fully(fd, &snapshot, sizeof(snapshot))
+              && lseek(fd, page_size, SEEK_SET) == (off_t) page_size
+              && write_fully(fd, buffer.buffer, snapshot.low_size)
+              && write_fully(fd, buffer.buffer + snapshot.high_offset, buffer.size - snapshot.high_offset);
+
+    // The site ids in the headers index the site table, so it is saved with them
+    m61_snapshot_site entries[SNAPSHOT_SITE_BATCH];
+    size_t nentries = 0;
+    for (uint32_t i = 0; ok && i != SITE_CAPACITY; ++i) {
+        if (sites[i].p_file) {
+            entries[nentries++] = {i, sites[i]};
+            if (nentries == SNAPSHOT_SITE_BATCH) {
+                ok = write_fully(fd, entries, sizeof(entries));
+                nentries = 0;
+            }
+        }
+    }
+    ok = ok && write_fully(fd, entries, nentries * sizeof(m61_snapshot_site));
+    ok = close(fd) == 0 && ok;
+    return ok;
+}
+
+/// clear_sites()
+///    Empties the site table.
+static void clear_sites() {
+    for (uint32_t i = 0; i != SITE_CAPACITY; ++i) {
+        if (sites[i].p_file) {
+            sites[i] = {};
+        }
+    }
+    last_site_file = nullptr;
+    last_site = NO_SITE;
+}
+
+/// read_snapshot_sites(fd, offset, nsites)
+///    Replaces the site table with the `nsites` entries saved at `offset` in the snapshot file `fd`. Returns false on
+///    failure, leaving the site table empty.
+static bool read_snapshot_sites(int fd, off_t offset, size_t nsites) {
+    clear_sites();
+
+    m61_snapshot_site entries[SNAPSHOT_SITE_BATCH];
+    while (nsites != 0) {
+        size_t nentries = std::min(nsites, SNAPSHOT_SITE_BATCH);
+        size_t sz = nentries * sizeof(m61_snapshot_site);
+        if (pread(fd, entries, sz, offset) != (ssize_t) sz) {
+            clear_sites();
+            return false;
+        }
+        for (size_t i = 0; i != nentries; ++i) {
+            if (entries[i].id < SITE_CAPACITY) {
+                sites[entries[i].id] = entries[i].site;
+            }
+        }
+        offset += sz;
+        nsites -= nentries;
+    }
+    return true;
+}
+
+/// m61_restore(path)
+///    Replaces the private heap with the snapshot in the file at `path`,
+///    mapped copy-on-write at the address it was taken at. The snapshot's
+///    allocations become active again and pages are only read from the
+///    file when they are touched. If this process runs the same program,
+///    the allocation sites are restored with them, replacing the site
+///    table. The soft limit is kept. Returns false on failure, if the
+///    private heap has active allocations, or if the address is not free.
+bool m61_restore(const char* path) {
+    if (heap != &default_heap || heap->stats.nactive != 0) {
+        errno = EBUSY;
+        return false;
+    }
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    m61_snapshot_header snapshot;
+    if (pread(fd, &snapshot, sizeof(snapshot), 0) != sizeof(snapshot) || snapshot.magic != SNAPSHOT_MAGIC) {
+        close(fd);
+        errno = EINVAL;
+        return false;
+    }
+
+    // The empty private heap may occupy the snapshot's address
+    if (heap->buffer.buffer) {
+        munmap(heap->buffer.buffer, heap->buffer.size);
+        size_t soft_limit = heap->buffer.soft_limit;
+        heap->buffer = m61_memory_buffer();
+        heap->buffer.soft_limit = soft_limit;
+    }
+
+    // Reserve the whole buffer, then map the saved parts over it
+    auto buf = (char*) snapshot.address;
+    void* ptr = mmap(buf, snapshot.size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE | MAP_FIXED_NOREPLACE, -1, 0);
+    if (ptr != buf) {
+        if (ptr != MAP_FAILED) {
+            munmap(ptr, snapshot.size);
+        }
+        close(fd);
+        errno = EEXIST;
+        return false;
+    }
+    size_t high_size = snapshot.size - snapshot.high_offset;
+    if ((snapshot.low_size != 0
+         && mmap(buf, snapshot.low_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd, page_size)
+            == MAP_FAILED)
+        || (high_size != 0
+            && mmap(buf + snapshot.high_offset, high_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_FIXED, fd,
+                    page_size + snapshot.low_size) == MAP_FAILED)) {
+        munmap(buf, snapshot.size);
+        close(fd);
+        return false;
+    }
+    if (snapshot.image == (uintptr_t) PREVIOUS_RUN
+        && !read_snapshot_sites(fd, page_size + snapshot.low_size + high_size, snapshot.nsites)) {
+        munmap(buf, snapshot.size);
+        close(fd);
+        return false;
+    }
+    close(fd);
+
+    heap->buffer.buffer = buf;
+    heap->buffer.size = snapshot.size;
+    heap->buffer.pos = snapshot.pos;
+    heap->buffer.end = snapshot.end;
+    heap->head = snapshot.head;
+    heap->top_block = snapshot.top_block;
+    heap->stats = snapshot.stats;
+    heap->free_space = snapshot.free_space;
+
+    // Source locations and site ids point into the process that took the snapshot. They are only kept if this
+    // process runs the same image at the same address, because fixing them copies every page with a header.
+    if (snapshot.image != (uintptr_t) PREVIOUS_RUN) {
+        for (header* p = heap->head; p; p = p->p_next) {
+            p->p_file = PREVIOUS_RUN;
+            p->line = 0;
+            p->site = NO_SITE;
+        }
+    }
+    return true;
+}
+
+/// m61_shared_offset(ptr)
+///    Returns the offset of `ptr`, which points into the current heap, from
+///    the start of the heap's buffer. Offsets identify an allocation in
+///    every process using the same shared heap.
+size_t m61_shared_offset(const void* ptr) {
+    return get_heap_offset(ptr);
+}
+
+/// m61_shared_pointer(offset)
+///    Returns the pointer at `offset` in the current heap's buffer. Inverse
+///    of `m61_shared_offset`.
+void* m61_shared_pointer(size_t offset) {
+    return heap->buffer.buffer + offset;
+}
+
+/// m61_heap_create(size, p_file, line)
+///    Returns a new heap with a private buffer of `size` bytes, or `nullptr`
+///    if it cannot be mapped. The heap has its own block list and
+///    statistics, and allocations from it fail once its buffer is full.
+m61_heap* m61_heap_create(size_t size, const char* file, int line) {
+    (void) file, (void) line;   // avoid uninitialized variable warnings
+
+    // The heap's state lives at the start of its own mapping, so destroying it is a single munmap
+    size_t state_size = (sizeof(m61_heap) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    if (size > SIZE_MAX - state_size) {
+        return nullptr;
+    }
+    void* ptr = mmap(nullptr, state_size + size, PROT_READ | PROT_WRITE, MAP_ANON | MAP_PRIVATE, -1, 0);
+    if (ptr == MAP_FAILED) {
+        return nullptr;
+    }
+
+    auto p_heap = new (ptr) m61_heap;
+    p_heap->buffer.buffer = (char*) ptr + state_size;
+    p_heap->buffer.size = size;
+    p_heap->buffer.end = size;
+    return p_heap;
+}
+
+/// m61_heap_destroy(p_heap)
+///    Releases the heap `p_heap` and all of its allocations at once. Does
+///    nothing if `p_heap == nullptr`.
+void m61_heap_destroy(m61_heap* p_heap) {
+    if (p_heap == nullptr) {
+        return;
+    }
+    assert(p_heap != heap && p_heap != &default_heap);
+
+    // The heap's allocations no longer count as active at their sites
+    {
+        m61_heap_scope scope(p_heap);
+        for (header* p = p_heap->head; p; p = p->p_next) {
+            if (p->status == ALLOCATED) {
+                record_site_free(p);
+            }
+        }
+    }
+    munmap(p_heap, p_heap->buffer.buffer - (char*) p_heap + p_heap->buffer.size);
+}
+
+/// m61_heap_malloc(p_heap, sz, p_file, line)
+///    Like `m61_malloc(sz, p_file, line)`, but allocates from `p_heap`.
+void* m61_heap_malloc(m61_heap* p_heap, size_t sz, const char* file, int line) {
+    m61_heap_scope scope(p_heap);
+    return m61_malloc(sz, file, line);
+}
+
+/// m61_heap_calloc(p_heap, count, sz, p_file, line)
+///    Like `m61_calloc(count, sz, p_file, line)`, but allocates from
+///    `p_heap`.
+void* m61_heap_calloc(m61_heap* p_heap, size_t count, size_t sz, const char* file, int line) {
+    m61_heap_scope scope(p_heap);
+    return m61_calloc(count, sz, file, line);
+}
+
+/// m61_heap_realloc(p_heap, ptr, sz, p_file, line)
+///    Like `m61_realloc(ptr, sz, p_file, line)` for an allocation from
+///    `p_heap`.
+void* m61_heap_realloc(m61_heap* p_heap, void* ptr, size_t sz, const char* file, int line) {
+    m61_heap_scope scope(p_heap);
+    return m61_realloc(ptr, sz, file, line);
+}
+
+/// m61_heap_free(p_heap, ptr, p_file, line)
+///    Like `m61_free(ptr, p_file, line)` for an allocation from `p_heap`.
+void m61_heap_free(m61_heap* p_heap, void* ptr, const char* file, int line) {
+    m61_heap_scope scope(p_heap);
+    m61_free(ptr, file, line);
+}
+
+/// m61_heap_get_statistics(p_heap)
+///    Returns the statistics of `p_heap`.
+m61_statistics m61_heap_get_statistics(m61_heap* p_heap) {
+    m61_heap_scope scope(p_heap);
+    return m61_get_statistics();
+}
+
+/// m61_heap_print_leak_report(p_heap)
+///    Prints a report of the active allocations of `p_heap`.
+void m61_heap_print_leak_report(m61_heap* p_heap) {
+    m61_heap_scope scope(p_heap);
+    m61_print_leak_report();
+}
+
+/// m61_register_pressure_callback(callback, arg)
+///    Registers `callback` to be called as `callback(p_heap, sz, arg)` when
+///    an allocation of `sz` bytes does not fit in its heap. `p_heap` is the
+///    heap instance the allocation was made from with the m61_heap_*
+///    functions, or nullptr for the process's heap. The callback should free
+///    memory it can spare, such as cache entries; the allocation is then
+///    retried before it falls back to the emergency reserve or fails. While
+///    callbacks run, the m61_malloc family uses the process's heap.
+///    Allocations made by callbacks do not call them again. Returns false if
+///    too many callbacks are registered.
+bool m61_register_pressure_callback(m61_pressure_callback callback, void* arg) {
+    if (npressure_callbacks == MAX_PRESSURE_CALLBACKS) {
+        return false;
+    }
+    pressure_callbacks[npressure_callbacks] = {callback, arg};
+    ++npressure_callbacks;
+    return true;
+}
+
+/// m61_unregister_pressure_callback(callback, arg)
+///    Unregisters a callback registered with the same `callback` and `arg`.
+void m61_unregister_pressure_callback(m61_pressure_callback callback, void* arg) {
+    for (size_t i = 0; i != npressure_callbacks; ++i) {
+        if (pressure_callbacks[i].callback == callback && pressure_callbacks[i].arg == arg) {
+            --npressure_callbacks;
+            std::copy(pressure_callbacks + i + 1, pressure_callbacks + npressure_callbacks + 1, pressure_callbacks + i);
+            return;
+        }
+    }
+}
+
+/// m61_set_soft_limit(limit)
+///    Sets the soft limit of the current heap to `limit` bytes, or removes
+///    it if `limit == 0`. When an allocation would grow the heap's footprint
+///    beyond the soft limit, the pressure callbacks are called, free memory
+///    is returned to the operating system and freed blocks are reused if
+///    possible. Allocations still succeed beyond the soft limit if there is
+///    room. The default is derived from the cgroup's memory limits.
+void m61_set_soft_limit(size_t limit) {
+    m61_heap_guard guard;
+    heap->buffer.soft_limit = limit;
+}
+
+/// m61_malloc_signal_safe(sz)
+///    Returns a pointer to `sz` bytes from the emergency reserve, or
+///    `nullptr` if the reserve has no room. Unlike the rest of the m61
+///    functions, it is async-signal-safe and may be called from signal
+///    handlers. The reserve is 64 KiB big and split into 1 KiB slots.
+void* m61_malloc_signal_safe(size_t sz) {
+    return reserve_alloc(sz, false, ALIGNMENT);
+}
+
+/// m61_free_signal_safe(ptr)
+///    Frees the allocation pointed to by `ptr`, which was returned by
+///    `m61_malloc_signal_safe`. Does nothing if `ptr == nullptr`.
+///    Async-signal-safe.
+void m61_free_signal_safe(void* ptr) {
+    if (ptr) {
+        reserve_free(ptr);
+    }
+}
+
+/// m61_is_emergency_allocation(ptr)
+///    Returns true if `ptr` was allocated from the emergency reserve, either
+///    by `m61_malloc_signal_safe` or by the m61_malloc family when the heap
+///    was exhausted.
+bool m61_is_emergency_allocation(const void* ptr) {
+    return is_reserve_pointer(ptr);
+}
+
+/// m61_default_resource()
+///    Returns a shared `m61_memory_resource`, for use as the upstream
+///    resource of standard pmr resources.
+m61_memory_resource* m61_default_resource() {
+    static m61_memory_resource resource("?", 0);
+    return &resource;
+}
+
+/// m61_get_statistics()
+///    Return the current memory statistics.
+m61_statistics m61_get_statistics() {
+    m61_heap_guard guard;
+    m61_statistics stats = heap->stats;
+    if (stats.heap_max) {
+        stats.heap_min += (uintptr_t) heap->buffer.buffer.get();
+        stats.heap_max += (uintptr_t) heap->buffer.buffer.get();
+    }
+    stats.footprint = get_footprint();
+    stats.soft_limit = heap->buffer.soft_limit;
+    return stats;
+}
+
+/// m61_reset_peak()
+///    Resets the peaks of the current heap to its current usage, so that
+///    the peaks of a phase of the program can be measured.
+void m61_reset_peak() {
+    m61_heap_guard guard;
+    m61_statistics& stats = heap->stats;
+    stats.peak_nactive = stats.nactive;
+    stats.peak_active_size = stats.active_size;
+    stats.peak_heap_span = stats.heap_max - stats.heap_min;
+    stats.peak_footprint = get_footprint();
+    stats.peak_nactive_at = stats.peak_active_size_at = stats.peak_heap_span_at = stats.peak_footprint_at
+        = stats.ntotal;
+}
+
+/// m61_print_statistics()
+///    Prints the current memory statistics.
+void m61_print_statistics() {
+    m61_statistics stats = m61_get_statistics();
+    printf("alloc count: active %10llu   total %10llu   fail %10llu\n",
+           stats.nactive, stats.ntotal, stats.nfail);
+    printf("alloc size:  active %10llu   total %10llu   fail %10llu\n",
+           stats.active_size, stats.total_size, stats.fail_size);
+}
+
+/// m61_get_size_histogram()
+///    Returns the allocation counts and bytes of the current heap by size
+///    class.
+m61_size_histogram m61_get_size_histogram() {
+    m61_heap_guard guard;
+    return heap->sizes;
+}
+
+/// m61_print_size_histogram()
+///    Prints the size histogram as a table with a row for each size class
+///    that has had allocations.
+void m61_print_size_histogram() {
+    m61_size_histogram sizes = m61_get_size_histogram();
+    printf("size class              active  active bytes       total   total bytes\n");
+    for (int i = 0; i != M61_NSIZE_CLASSES; ++i) {
+        if (sizes.ntotal[i] == 0) {
+            continue;
+        }
+        unsigned long long min = i ? 1ULL << (i - 1) : 0;
+        unsigned long long max = i ? min * 2 - 1 : 0;
+        printf("%10llu-%-10llu %10llu %13llu  %10llu %13llu\n", min, max, sizes.nactive[i], sizes.active_size[i],
+               sizes.ntotal[i], sizes.total_size[i]);
+    }
+}
+
+/// m61_get_fragmentation()
+///    Returns the free blocks and overhead of the current heap. The counts
+///    are kept up to date as blocks are freed and reused, so only the
+///    largest free block may need a search of the block list. The free
+///    space at the buffer position is not a free block and is not counted.
+m61_fragmentation m61_get_fragmentation() {
+    m61_heap_guard guard;
+    m61_fragmentation fragmentation = {};
+    fragmentation.nfree = heap->free_space.nblocks;
+    fragmentation.free_size = heap->free_space.size;
+    fragmentation.largest_free = get_largest_free_block();
+    if (fragmentation.free_size) {
+        fragmentation.external = 1.0 - (double) fragmentation.largest_free / fragmentation.free_size;
+    }
+
+    // Allocations from the emergency reserve count as active but are not in the heap's blocks
+    size_t allocated_size = get_footprint() - heap->free_space.size;
+    if (allocated_size > heap->stats.active_size) {
+        fragmentation.overhead = allocated_size - heap->stats.active_size;
+    }
+    return fragmentation;
+}
+
+/// m61_print_extended_statistics()
+///    Prints the current memory statistics, followed by the footprint of
+///    the heap, its free blocks and its fragmentation.
+void m61_print_extended_statistics() {
+    m61_print_statistics();
+    m61_statistics stats = m61_get_statistics();
+    m61_fragmentation fragmentation = m61_get_fragmentation();
+    printf("footprint:   current %9llu   peak %11llu   overhead %7llu\n",
+           stats.footprint, stats.peak_footprint, fragmentation.overhead);
+    printf("free blocks: count %11llu   size %11llu   largest %8llu\n",
+           fragmentation.nfree, fragmentation.free_size, fragmentation.largest_free);
+    printf("fragmentation: external %5.1f%%\n", fragmentation.external * 100);
+}
+
+/// m61_print_latency_report()
+///    Prints the number of recorded calls of each operation and their
+///    50th, 90th, 99th and 99.9th percentile and maximum latencies in
+///    nanoseconds. Percentiles are the upper bounds of histogram buckets,
+///    so they overestimate by at most 1/16. Each m61_malloc_batch and
+///    m61_free_batch call counts once, whatever its number of blocks. Not
+///    recorded: m61_pool slots, which are taken and returned inline, and
+///    the creation, reset and destruction of arenas.
+void m61_print_latency_report() {
+    static const double percentiles[] = {0.5, 0.9, 0.99, 0.999};
+    printf("operation           count        p50        p90        p99      p99.9        max\n");
+    for (int op = 0; op != NOPERATIONS; ++op) {
+        const m61_latency_histogram& histogram = latencies[op];
+        unsigned long long count = histogram.count.load(std::memory_order_relaxed);
+        unsigned long long max = histogram.max.load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        printf("%-13s  %10llu", OPERATION_NAMES[op], count);
+        int bucket = 0;
+        unsigned long long seen = histogram.buckets[0].load(std::memory_order_relaxed);
+        for (double percentile : percentiles) {
+            // The latency of the ceil(count * percentile)th fastest call
+            auto rank = (unsigned long long) (count * percentile);
+            rank += rank < count * percentile;
+            while (seen < rank && bucket != LATENCY_NBUCKETS - 1) {
+                seen += histogram.buckets[++bucket].load(std::memory_order_relaxed);
+            }
+            printf(" %10llu", std::min(get_latency_bucket_max(bucket), max));
+        }
+        printf(" %10llu\n", max);
+    }
+}
+
+/// m61_print_site_report(top_k)
+///    Prints the `top_k` allocation sites with the most bytes in active
+///    allocations, from the most to the least, with their active, total
+///    and freed allocations and the mean lifetime of the freed ones in
+///    allocations. Sites of shared heap allocations are not tracked.
+void m61_print_site_report(size_t top_k) {
+    static uint32_t order[SITE_CAPACITY];
+    size_t nsites = 0;
+    for (uint32_t i = 0; i != SITE_CAPACITY; ++i) {
+        if (sites[i].ntotal != 0) {
+            order[nsites++] = i;
+        }
+    }
+    top_k = std::min(top_k, nsites);
+    std::partial_sort(order, order + top_k, order + nsites, [](uint32_t a, uint32_t b) {
+        const m61_site& site_a = sites[a];
+        const m61_site& site_b = sites[b];
+        if (site_a.active_size != site_b.active_size) {
+            return site_a.active_size > site_b.active_size;
+        } else if (site_a.total_size != site_b.total_size) {
+            return site_a.total_size > site_b.total_size;
+        }
+        return site_a.ntotal > site_b.ntotal;
+    });
+
+    printf("    active  active bytes       total   total bytes       frees  mean lifetime  site\n");
+    for (size_t i = 0; i != top_k; ++i) {
+        const m61_site& site = sites[order[i]];
+        printf("%10llu %13llu  %10llu %13llu  %10llu ", site.nactive, site.active_size, site.ntotal, site.total_size,
+               site.nfrees);
+        if (site.nfrees != 0) {
+            printf("%14llu", site.total_lifetime / site.nfrees);
+        } else {
+            printf("%14s", "-");
+        }
+        printf("  %s:%d\n", site.p_file, site.line);
+    }
+}
+
+/// m61_print_leak_report()
+///    Prints a report of all currently-active allocated blocks of dynamic memory.
+void m61_print_leak_report() {
+    m61_heap_guard guard;
+
+    header* p_header = heap->head;
+    // Traverse the linked list
+    while (p_header) {
+        // Print to stdout if the block is allocated
+        if (p_header->status == ALLOCATED) {
+            size_t payload_size = get_payload_size(p_header);
+            fprintf(stdout, "LEAK CHECK: %s:%d: allocated object %p with size %zu\n", get_block_file(p_header),
+                    get_block_line(p_header), p_header->p_payload.get(), payload_size);
+        }
+        p_header = p_header->p_next;
+    }
+}
+
+/// resize_block(p_header, required_size)
+///    Tries to change the block size of the allocated block pointed to by the given header pointer to
+///    'required_size' without moving it. A block shrinks by splitting off its tail as a free block. A block grows by
+///    extending the buffer position if it is the last block, or by absorbing its successor if that block is free.
+///    Returns true on success. Otherwise, returns false and leaves the block unchanged.
+static bool resize_block(header* p_header, size_t required_size) {
+    // Shrink by splitting off the tail, then merge the tail with a free successor
+    if (required_size <= p_header->block_size) {
+        size_t old_block_size = p_header->block_size;
+        split_block(p_header, required_size);
+        if (p_header->block_size != old_block_size) {
+            coalesce(p_header->p_prev);
+            move_buffer_pos();
+        }
+        return true;
+    }
+
+    size_t extra_size = required_size - p_header->block_size;
+
+    // Grow into the default buffer if this is the last block of the default region
+    if (p_header == get_pos_block()) {
+        if (heap->buffer.end - heap->buffer.pos < extra_size) {
+            return false;
+        }
+        p_header->block_size = required_size;
+        heap->buffer.pos += extra_size;
+        return true;
+    }
+
+    // Grow by absorbing the successor if it is free and large enough
+    if (can_coalesce_up(p_header) && p_header->p_prev->block_size >= extra_size) {
+        remove_free_space(p_header->p_prev->block_size);
+        p_header->block_size += p_header->p_prev->block_size;
+        remove_block(p_header->p_prev);
+        split_block(p_header, required_size);
+        return true;
+    }
+
+    return false;
+}
+
+/// m61_realloc(ptr, sz, p_file, line)
+///    Changes the size of the dynamic allocation pointed to by `ptr`
+///    to hold at least `sz` bytes. The allocation is resized in place if
+///    possible. Otherwise, this function makes a new allocation, copies as
+///    much data as possible from the old allocation to the new, and returns
+///    a pointer to the new allocation. If `ptr` is `nullptr`, behaves like
+///    `m61_malloc(sz, p_file, line). `sz` must not be 0. If a required
+///    allocation fails, returns `nullptr` without freeing the original
+///    block. Either way the statistics count the result as a new allocation
+///    and the old one as freed.
+void* m61_realloc(void* ptr, size_t sz, const char* file, int line) {
+    m61_latency_timer timer(OP_REALLOC);
+    m61_heap_scope scope(get_owning_heap(ptr));
+    m61_heap_guard guard;
+
+    (void) file, (void) line;   // avoid uninitialized variable warnings
+
+    if (!sz){
+        return nullptr;
+    }
+
+    if (!ptr) {
+        return m61_malloc(sz, file, line);
+    }
+
+    // Move emergency reserve allocations back to the heap if possible
+    if (is_reserve_pointer(ptr)) {
+        void* new_ptr = m61_malloc(sz, file, line);
+        if (new_ptr) {
+            memcpy(new_ptr, ptr, std::min(sz, ((m61_reserve_header*) ptr)[-1].size));
+            release_reserve_allocation(ptr);
+        }
+        return new_ptr;
+    }
+
+    header* p_header = check_free(ptr, file, line);
+    size_t old_payload_size = get_payload_size(p_header);
+    size_t old_block_size = p_header->block_size;
+
+    size_t block_size;
+    if (!get_block_size(sz, &block_size)) {
+        update_statistics_for_failure(sz);
+        return nullptr;
+    }
+
+    // Growing past the buffer position would exceed the soft limit: move the block into freed memory if possible
+    void* new_ptr = nullptr;
+    if (heap->buffer.soft_limit && block_size > p_header->block_size && p_header == get_pos_block()
+        && get_footprint() + (block_size - p_header->block_size) > heap->buffer.soft_limit) {
+        new_ptr = place_under_soft_limit(block_size, sz, ALIGNMENT, file, line);
+    }
+
+    // Try to resize the block in place and move its end marker
+    if (!new_ptr && resize_block(p_header, block_size)) {
+        p_header->p_file = file;
+        p_header->line = line;
+        record_site_free(p_header);
+        remove_from_mark_totals(p_header, old_block_size);
+        set_alloc_site(p_header, sz, file, line);
+        p_header->p_end_marker = p_header->p_payload + sz;
+        add_end_marker(p_header->p_end_marker);
+
+        remove_from_statistics(old_payload_size);
+        add_to_statistics(sz, ptr);
+        return ptr;
+    }
+
+    if (new_ptr) {
+        add_to_statistics(sz, new_ptr);
+    } else {
+        // Keep long-lived blocks in the long-lived region. Other blocks are placed as their site predicts.
+        bool is_long_lived = (char*) p_header >= heap->buffer.buffer + heap->buffer.end;
+        new_ptr = m61_malloc_hint(sz, is_long_lived ? M61_LONG_LIVED : 0, file, line);
+        if (!new_ptr) {
+            return nullptr;
+        }
+    }
+
+    // Copy the whole old payload if 'sz' is larger than it. Otherwise, copy only 'sz' bytes
+    if (sz > old_payload_size) {
+        memcpy(new_ptr, ptr, old_payload_size);
+    } else {
+        memcpy(new_ptr, ptr, sz);
+    }
+
+    release_block(p_header, old_payload_size, file, line);
+
+    return new_ptr;
+}
@@ -5,8 +5,11 @@
 #include <cstddef>
 #include <cinttypes>
 #include <cstdio>
+#include <memory_resource>
 #include <new>
 #include <random>
+#include <source_location>
+#include <utility>
 
 
 
@@ -14,10 +17,48 @@
 ///    Return a pointer to `sz` bytes of newly-allocated dynamic memory.
 void* m61_malloc(size_t sz, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
+/// Lifetime hints for m61_malloc_hint.
+enum m61_lifetime_hint {
+    M61_SHORT_LIVED = 1,    // allocation dies soon, e.g. a per-request temporary
+    M61_LONG_LIVED = 2      // allocation survives many others, e.g. a cache entry
+};
+
+/// m61_malloc_hint(sz, hint, p_file, line)
+///    Like m61_malloc, but place the allocation according to its expected
+///    lifetime `hint`, so long-lived objects do not pin holes between
+///    short-lived ones.
+void* m61_malloc_hint(size_t sz, int hint, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+/// m61_set_lifetime_prediction(enabled)
+///    Enable or disable placing unhinted allocations according to the
+///    lifetimes previously observed at their allocation site.
+void m61_set_lifetime_prediction(bool enabled);
+
 /// m61_free(ptr, p_file, line)
 ///    Free the memory space pointed to by `ptr`.
 void m61_free(void* ptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
+/// m61_free_sized(ptr, sz, p_file, line)
+///    Free the memory space pointed to by `ptr`, which was allocated with
+///    size `sz`. Skips most of the checks of `m61_free`; the size is only
+///    validated in debug (non-NDEBUG) builds.
+void m61_free_sized(void* ptr, size_t sz, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+/// m61_malloc_usable_size(ptr)
+///    Return the size of the allocation pointed to by `ptr`.
+size_t m61_malloc_usable_size(void* ptr);
+
+/// m61_malloc_batch(sz, n, ptrs, p_file, line)
+///    Allocate `n` blocks of `sz` bytes each into `ptrs`. Blocks that do not
+///    fit are allocated as by `m61_malloc`. Return the number of blocks
+///    allocated; the remaining entries of `ptrs` are set to `nullptr`.
+size_t m61_malloc_batch(size_t sz, size_t n, void** ptrs, const char* file = __builtin_FILE(),
+                        int line = __builtin_LINE());
+
+/// m61_free_batch(ptrs, n, p_file, line)
+///    Free the `n` allocations in `ptrs`. Null entries are skipped.
+void m61_free_batch(void** ptrs, size_t n, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
 /// m61_calloc(count, sz, p_file, line)
 ///    Return a pointer to newly-allocated dynamic memory big enough to
 ///    hold an array of `count` elements of `sz` bytes each. The memory
@@ -29,6 +70,147 @@ void* m61_calloc(size_t count, size_t sz, const char* file = __builtin_FILE(), i
 ///    to hold at least `sz` bytes.
 void* m61_realloc(void* ptr, size_t sz, const char* file = __builtin_FILE(), int line = __builtin_LINE());
 
+/// m61_aligned_alloc(alignment, sz, p_file, line)
+///    Return a pointer to `sz` bytes of newly-allocated dynamic memory
+///    aligned to `alignment`, which must be a power of two.
+void* m61_aligned_alloc(size_t alignment, size_t sz, const char* file = __builtin_FILE(),
+                        int line = __builtin_LINE());
+
+/// m61_posix_memalign(p_ptr, alignment, sz, p_file, line)
+///    Store a pointer to `sz` bytes of newly-allocated dynamic memory
+///    aligned to `alignment` in `*p_ptr`. Return 0 on success, EINVAL for a
+///    bad alignment, or ENOMEM if out of memory.
+int m61_posix_memalign(void** p_ptr, size_t alignment, size_t sz, const char* file = __builtin_FILE(),
+                       int line = __builtin_LINE());
+
+/// m61_memalign(alignment, sz, p_file, line)
+///    Same as m61_aligned_alloc.
+void* m61_memalign(size_t alignment, size_t sz, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+struct m61_heap;
+
+/// m61_pressure_callback
+///    Function called with the heap instance an allocation does not fit in,
+///    or nullptr for the process's heap, the size of the allocation, and the
+///    argument it was registered with.
+using m61_pressure_callback = void (*)(m61_heap* p_heap, size_t sz, void* arg);
+
+/// m61_register_pressure_callback(callback, arg)
+///    Call `callback(p_heap, sz, arg)` to release memory before an
+///    allocation fails.
+///    Return false if too many callbacks are registered.
+bool m61_register_pressure_callback(m61_pressure_callback callback, void* arg);
+
+/// m61_unregister_pressure_callback(callback, arg)
+///    Stop calling a registered callback.
+void m61_unregister_pressure_callback(m61_pressure_callback callback, void* arg);
+
+/// m61_set_soft_limit(limit)
+///    Reclaim memory before the heap's footprint grows beyond `limit` bytes.
+///    0 removes the limit. The default comes from the cgroup memory limits.
+void m61_set_soft_limit(size_t limit);
+
+/// m61_malloc_signal_safe(sz), m61_free_signal_safe(ptr)
+///    Allocate or free memory from the emergency reserve. Unlike the other
+///    m61 functions, these may be called from signal handlers.
+void* m61_malloc_signal_safe(size_t sz);
+void m61_free_signal_safe(void* ptr);
+
+/// m61_is_emergency_allocation(ptr)
+///    Return true if `ptr` came from the emergency reserve. The m61_malloc
+///    family falls back to the reserve when the private heap is exhausted.
+bool m61_is_emergency_allocation(const void* ptr);
+
+/// m61_arena
+///    Region of memory whose allocations are all released together.
+struct m61_arena;
+
+/// m61_arena_create(chunk_size, p_file, line)
+///    Return a new arena that takes memory from the m61 heap in chunks of
+///    `chunk_size` bytes.
+m61_arena* m61_arena_create(size_t chunk_size = 64 << 10, const char* file = __builtin_FILE(),
+                            int line = __builtin_LINE());
+
+/// m61_arena_alloc(p_arena, sz, p_file, line)
+///    Return a pointer to `sz` bytes of memory from the arena.
+void* m61_arena_alloc(m61_arena* p_arena, size_t sz, const char* file = __builtin_FILE(),
+                      int line = __builtin_LINE());
+
+/// m61_arena_reset(p_arena, p_file, line)
+///    Release all memory allocated from the arena.
+void m61_arena_reset(m61_arena* p_arena, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+/// m61_arena_destroy(p_arena, p_file, line)
+///    Release all memory allocated from the arena and the arena itself.
+void m61_arena_destroy(m61_arena* p_arena, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+/// m61_shared_heap_create(name, size)
+///    Create a heap of `size` bytes in the POSIX shared memory object `name`,
+///    or in an anonymous memfd if `name == nullptr`, and allocate from it.
+///    Earlier allocations from the private heap are still freed there.
+///    Return a file descriptor for the object, or -1 on failure.
+int m61_shared_heap_create(const char* name, size_t size);
+
+/// m61_shared_heap_attach(fd)
+///    Map the shared heap object `fd` and allocate from it. The address may
+///    differ from other processes'; link allocations with m61_offset_ptr or
+///    m61_shared_offset. Return false on failure.
+bool m61_shared_heap_attach(int fd);
+
+/// m61_shared_heap_detach()
+///    Unmap the shared heap and allocate from the private heap again.
+void m61_shared_heap_detach();
+
+/// m61_shared_offset(ptr), m61_shared_pointer(offset)
+///    Convert between pointers into the current heap and offsets that
+///    identify them in every process sharing it.
+size_t m61_shared_offset(const void* ptr);
+void* m61_shared_pointer(size_t offset);
+
+/// m61_persistent_heap_open(path, size)
+///    Allocate from the persistent heap in the file at `path`, creating it
+///    with `size` bytes if needed. Existing allocations are recovered, at
+///    their old addresses if those are free. Return false on failure.
+bool m61_persistent_heap_open(const char* path, size_t size);
+
+/// m61_persistent_heap_close()
+///    Write the persistent heap to its file and allocate from the private
+///    heap again.
+void m61_persistent_heap_close();
+
+/// m61_set_root(ptr), m61_get_root()
+///    Set or return the root pointer stored in the persistent heap.
+void m61_set_root(void* ptr);
+void* m61_get_root();
+
+/// m61_snapshot(path)
+///    Write the used parts of the private heap to the file at `path`.
+///    Return false on failure.
+bool m61_snapshot(const char* path);
+
+/// m61_restore(path)
+///    Replace the empty private heap with the snapshot at `path`, mapped
+///    copy-on-write at its original address. Return false on failure.
+bool m61_restore(const char* path);
+
+/// m61_checkpoint
+///    Position of the heap returned by m61_mark.
+struct m61_checkpoint {
+    size_t pos;                         // buffer position when the mark was taken
+    unsigned long long ntotal;          // # total allocations when the mark was taken
+    unsigned depth;                     // # marks active before this one
+    unsigned long long noutside;        // # allocations placed away from the buffer position under marks
+};
+
+/// m61_mark()
+///    Return a checkpoint of the heap. Marks nest like a stack.
+m61_checkpoint m61_mark();
+
+/// m61_release(mark, p_file, line)
+///    Free every allocation made since `mark` at once, and release `mark`
+///    together with all marks taken after it.
+void m61_release(const m61_checkpoint& mark, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
 
 /// m61_statistics
 ///    Structure tracking memory statistics.
@@ -41,55 +223,503 @@ struct m61_statistics {
     unsigned long long fail_size;       // # bytes in failed alloc attempts
     uintptr_t heap_min;                 // smallest allocated addr
     uintptr_t heap_max;                 // largest allocated addr
+    unsigned long long footprint;       // # bytes of the heap covered by blocks
+    unsigned long long soft_limit;      // soft limit of the footprint, or 0
+    // Peaks since the start or the last m61_reset_peak(), each with the
+    // value of `ntotal` when it was reached
+    unsigned long long peak_nactive;
+    unsigned long long peak_nactive_at;
+    unsigned long long peak_active_size;
+    unsigned long long peak_active_size_at;
+    unsigned long long peak_heap_span;  // heap_max - heap_min
+    unsigned long long peak_heap_span_at;
+    unsigned long long peak_footprint;  // bounds the heap's resident memory
+    unsigned long long peak_footprint_at;
+};
+
+/// Number of size classes in m61_size_histogram.
+constexpr int M61_NSIZE_CLASSES = 65;
+
+/// m61_size_histogram
+///    Allocation counts and bytes by size class. Size class 0 holds
+///    allocations of 0 bytes and size class `i` allocations of
+///    [2^(i-1), 2^i) bytes.
+struct m61_size_histogram {
+    unsigned long long nactive[M61_NSIZE_CLASSES];      // # active allocations
+    unsigned long long active_size[M61_NSIZE_CLASSES];  // # bytes in active allocations
+    unsigned long long ntotal[M61_NSIZE_CLASSES];       // # total allocations
+    unsigned long long total_size[M61_NSIZE_CLASSES];   // # bytes in total allocations
+};
+
+/// m61_offset_ptr<T>
+///    Pointer stored as its distance from its own address, so structures
+///    linked with it stay valid wherever their memory is mapped. Use it for
+///    links between allocations of a shared or persistent heap. A distance
+///    of 0 is the null pointer.
+template <typename T>
+class m61_offset_ptr {
+public:
+    constexpr m61_offset_ptr() noexcept : offset_(0) {
+    }
+    m61_offset_ptr(T* ptr) noexcept {
+        set(ptr);
+    }
+    m61_offset_ptr(const m61_offset_ptr<T>& other) noexcept {
+        set(other.get());
+    }
+    m61_offset_ptr<T>& operator=(const m61_offset_ptr<T>& other) noexcept {
+        set(other.get());
+        return *this;
+    }
+    m61_offset_ptr<T>& operator=(T* ptr) noexcept {
+        set(ptr);
+        return *this;
+    }
+
+    T* get() const noexcept {
+        return offset_ ? (T*) ((char*) this + offset_) : nullptr;
+    }
+    operator T*() const noexcept {
+        return get();
+    }
+    T* operator->() const noexcept {
+        return get();
+    }
+
+private:
+    ptrdiff_t offset_;
+
+    void set(T* ptr) noexcept {
+        offset_ = ptr ? (char*) ptr - (char*) this : 0;
+    }
 };
 
 struct alignas(alignof(std::max_align_t)) header {
-    size_t block_size;         // size of header + p_payload + padding
-    char* p_payload;           // pointer for the payload
-    char* p_end_marker;        // pointer for the end marker
-    char* p_status;            // FREE or ALLOCATED
-    const char* p_file;        // source code file where the allocation/free request was made
-    int line;                  // source code line where the allocation/free request was made
-    struct header* p_next;     // header pointer for the next block of memory
-    struct header* p_prev;     // header pointer for the previous block of memory
+    size_t block_size;                  // size of header + p_payload + padding
+    m61_offset_ptr<char> p_payload;     // pointer for the payload
+    m61_offset_ptr<char> p_end_marker;  // pointer for the end marker
+    const char* p_file;                 // source code file where the allocation/free request was made
+    int line;                           // source code line where the allocation/free request was made
+    uint32_t status;                    // FREE or ALLOCATED
+    uint32_t site;                      // id of the allocation site
+    uint32_t alloc_clock;               // allocation count (mod 2^32) when the block was allocated
+    m61_offset_ptr<header> p_next;      // header pointer for the next block of memory
+    m61_offset_ptr<header> p_prev;      // header pointer for the previous block of memory
 };
 
+// Size of the marker written after each payload to detect wild writes
+constexpr size_t M61_END_MARKER_SIZE = 8;
+
+/// m61_block_size(sz)
+///    Return the size of the block that holds a `sz`-byte allocation: the
+///    header, the payload, and padding that fits the end marker and keeps
+///    the next block aligned.
+constexpr size_t m61_block_size(size_t sz) {
+    constexpr size_t alignment = alignof(std::max_align_t);
+    size_t padding = alignment - (sizeof(header) + sz) % alignment;
+    if (padding < M61_END_MARKER_SIZE) {
+        padding += alignment;
+    }
+    return sizeof(header) + sz + padding;
+}
+
+/// m61_malloc_block(block_size, sz, p_file, line)
+///    Like `m61_malloc(sz, p_file, line)` for a block size precomputed with
+///    `m61_block_size(sz)`.
+void* m61_malloc_block(size_t block_size, size_t sz, const char* file = __builtin_FILE(),
+                       int line = __builtin_LINE());
+
 /// m61_get_statistics()
 ///    Return the current memory statistics.
 m61_statistics m61_get_statistics();
 
+/// m61_reset_peak()
+///    Restart peak tracking from the current usage, e.g. for a new phase.
+void m61_reset_peak();
+
 /// m61_print_statistics()
 ///    Print the current memory statistics.
 void m61_print_statistics();
 
+/// m61_get_size_histogram()
+///    Return the allocation counts and bytes by size class.
+m61_size_histogram m61_get_size_histogram();
+
+/// m61_print_size_histogram()
+///    Print the allocation counts and bytes by size class.
+void m61_print_size_histogram();
+
+/// m61_fragmentation
+///    Free space between the blocks of the heap, and space used by
+///    allocations beyond their requested sizes.
+struct m61_fragmentation {
+    unsigned long long nfree;           // # free blocks
+    unsigned long long free_size;       // # bytes in free blocks
+    unsigned long long largest_free;    // # bytes in the largest free block
+    double external;                    // 1 - largest_free / free_size, or 0
+    unsigned long long overhead;        // # bytes of headers and padding
+};
+
+/// m61_get_fragmentation()
+///    Return the free space and overhead of the heap.
+m61_fragmentation m61_get_fragmentation();
+
+/// m61_print_extended_statistics()
+///    Print the current memory statistics, followed by the footprint and
+///    fragmentation of the heap.
+void m61_print_extended_statistics();
+
+/// m61_set_latency_tracking(enabled)
+///    Enable or disable recording how long m61_malloc, m61_free,
+///    m61_realloc, m61_calloc, m61_aligned_alloc, m61_malloc_batch,
+///    m61_free_batch and m61_arena_alloc calls take. Disabled by default.
+void m61_set_latency_tracking(bool enabled);
+
+/// m61_print_latency_report()
+///    Print latency percentiles of the recorded calls by operation.
+void m61_print_latency_report();
+
+/// m61_print_site_report(top_k)
+///    Print the `top_k` allocation sites with the most bytes in active
+///    allocations, with their allocation counts and mean lifetimes.
+void m61_print_site_report(size_t top_k = 10);
+
 /// m61_print_leak_report()
 ///    Print a report of all currently-active allocated blocks of dynamic
 ///    memory.
 void m61_print_leak_report();
 
+/// m61_heap
+///    Independent heap with its own buffer, block list and statistics.
+struct m61_heap;
+
+/// m61_heap_create(size, p_file, line)
+///    Return a new heap whose buffer is `size` bytes big.
+m61_heap* m61_heap_create(size_t size, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+/// m61_heap_destroy(p_heap)
+///    Release `p_heap` and all of its allocations at once.
+void m61_heap_destroy(m61_heap* p_heap);
+
+/// m61_heap_malloc, m61_heap_calloc, m61_heap_realloc, m61_heap_free
+///    Like m61_malloc, m61_calloc, m61_realloc and m61_free, but on `p_heap`.
+void* m61_heap_malloc(m61_heap* p_heap, size_t sz, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+void* m61_heap_calloc(m61_heap* p_heap, size_t count, size_t sz, const char* file = __builtin_FILE(),
+                      int line = __builtin_LINE());
+void* m61_heap_realloc(m61_heap* p_heap, void* ptr, size_t sz, const char* file = __builtin_FILE(),
+                       int line = __builtin_LINE());
+void m61_heap_free(m61_heap* p_heap, void* ptr, const char* file = __builtin_FILE(), int line = __builtin_LINE());
+
+/// m61_heap_get_statistics(p_heap), m61_heap_print_leak_report(p_heap)
+///    Return the statistics of `p_heap`, or print its active allocations.
+m61_statistics m61_heap_get_statistics(m61_heap* p_heap);
+void m61_heap_print_leak_report(m61_heap* p_heap);
+
 
 /// This magic class lets standard C++ containers use your allocator
-/// instead of the system allocator.
+/// instead of the system allocator. A default-constructed allocator, like
+/// the ones containers construct themselves, attributes its allocations to
+/// the unknown site `?:0`. Only an allocator constructed explicitly from a
+/// source location is attributed to it: pass
+/// `m61_allocator<T>(std::source_location::current())` to a container to
+/// attribute its allocations to the container's call site.
 template <typename T>
 class m61_allocator {
 public:
     using value_type = T;
-    m61_allocator() noexcept = default;
+    m61_allocator() noexcept
+        : file_("?"), line_(0) {
+    }
+    explicit m61_allocator(const std::source_location& loc) noexcept
+        : file_(loc.file_name()), line_(loc.line()) {
+    }
     m61_allocator(const m61_allocator<T>&) noexcept = default;
-    template <typename U> m61_allocator(m61_allocator<U>&) noexcept {}
+    template <typename U> m61_allocator(const m61_allocator<U>& other) noexcept
+        : file_(other.file_), line_(other.line_) {
+    }
 
     T* allocate(size_t n) {
-        return reinterpret_cast<T*>(m61_malloc(n * sizeof(T), "?", 0));
+        if constexpr (alignof(T) > alignof(std::max_align_t)) {
+            return reinterpret_cast<T*>(m61_aligned_alloc(alignof(T), n * sizeof(T), file_, line_));
+        } else {
+            if (n == 1) {
+                constexpr size_t block_size = m61_block_size(sizeof(T));
+                return reinterpret_cast<T*>(m61_malloc_block(block_size, sizeof(T), file_, line_));
+            }
+            return reinterpret_cast<T*>(m61_malloc(n * sizeof(T), file_, line_));
+        }
     }
-    void deallocate(T* ptr, size_t) {
-        m61_free(ptr, "?", 0);
+    void deallocate(T* ptr, size_t n) {
+        m61_free_sized(ptr, n * sizeof(T), file_, line_);
     }
+
+private:
+    template <typename U> friend class m61_allocator;
+
+    const char* file_;
+    int line_;
 };
 template <typename T, typename U>
 inline constexpr bool operator==(const m61_allocator<T>&, const m61_allocator<U>&) {
     return true;
 }
 
+/// m61_new_at<T>(loc, args...)
+///    Allocate and construct a `T` from `args`, attributing the allocation
+///    to source location `loc`. The block size is computed at compile time.
+///    Throws `std::bad_alloc` if out of memory.
+template <typename T, typename... Args>
+T* m61_new_at(const std::source_location& loc, Args&&... args) {
+    const char* file = *loc.file_name() ? loc.file_name() : "?";
+    int line = loc.line();
+    void* ptr;
+    if constexpr (alignof(T) > alignof(std::max_align_t)) {
+        ptr = m61_aligned_alloc(alignof(T), sizeof(T), file, line);
+    } else {
+        constexpr size_t block_size = m61_block_size(sizeof(T));
+        ptr = m61_malloc_block(block_size, sizeof(T), file, line);
+    }
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    try {
+        return new (ptr) T(std::forward<Args>(args)...);
+    } catch (...) {
+        m61_free_sized(ptr, sizeof(T), file, line);
+        throw;
+    }
+}
+
+/// m61_new<T>(args...)
+///    Allocate and construct a `T` from `args`, like `m61_new_at`. A
+///    default-constructed `T` is attributed to the call site; one constructed
+///    from arguments is not, since no default argument can follow `args`, so
+///    use `M61_NEW` instead.
+template <typename T>
+T* m61_new(std::source_location loc = std::source_location::current()) {
+    return m61_new_at<T>(loc);
+}
+template <typename T, typename... Args> requires (sizeof...(Args) != 0)
+T* m61_new(Args&&... args) {
+    return m61_new_at<T>(std::source_location(), std::forward<Args>(args)...);
+}
+
+/// M61_NEW(T, args...)
+///    Allocate and construct a `T` from `args`, attributing the allocation
+///    to the call site. A `T` whose name contains commas needs an alias.
+#define M61_NEW(T, ...) m61_new_at<T>(std::source_location::current() __VA_OPT__(,) __VA_ARGS__)
+
+/// m61_delete(ptr)
+///    Destroy and free a `T` allocated by `m61_new<T>`. The dynamic type of
+///    `*ptr` must be `T`, since the free is sized by `sizeof(T)`.
+template <typename T>
+void m61_delete(T* ptr, std::source_location loc = std::source_location::current()) {
+    if (ptr) {
+        ptr->~T();
+        m61_free_sized(ptr, sizeof(T), loc.file_name(), loc.line());
+    }
+}
+
+/// m61_pool<T>
+///    Pool of fixed-size slots for objects of type `T`. Slots are carved
+///    from chunks obtained with `m61_malloc`, so they have no per-object
+///    header; freed slots are kept on an intrusive free list and reused.
+///    Chunks are returned to the heap when the pool is destroyed.
+template <typename T>
+class m61_pool {
+public:
+    explicit m61_pool(const char* file = __builtin_FILE(), int line = __builtin_LINE()) noexcept
+        : file_(file), line_(line) {
+    }
+    m61_pool(const m61_pool<T>&) = delete;
+    m61_pool<T>& operator=(const m61_pool<T>&) = delete;
+    ~m61_pool() {
+        while (slot* chunk = chunks_) {
+            chunks_ = chunk->next;
+            m61_free(chunk, file_, line_);
+        }
+    }
+
+    /// Return a slot big enough for one `T`, or `nullptr` if out of memory.
+    T* allocate() {
+        if (!free_ && !grow()) {
+            return nullptr;
+        }
+        slot* s = free_;
+        free_ = s->next;
+        return reinterpret_cast<T*>(s);
+    }
+    /// Return the slot at `ptr`, which came from `allocate`, to the pool.
+    void deallocate(T* ptr) noexcept {
+        slot* s = reinterpret_cast<slot*>(ptr);
+        s->next = free_;
+        free_ = s;
+    }
+
+private:
+    union slot {
+        slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    slot* free_ = nullptr;         // free slots
+    slot* chunks_ = nullptr;       // chunks, linked through their first slot
+    size_t chunk_slots_ = 16;      // slots in the next chunk
+    const char* file_;
+    int line_;
+
+    bool grow() {
+        // The first slot of each chunk links the chunks together
+        slot* chunk = reinterpret_cast<slot*>(m61_malloc((chunk_slots_ + 1) * sizeof(slot), file_, line_));
+        if (!chunk) {
+            return false;
+        }
+        chunk->next = chunks_;
+        chunks_ = chunk;
+        for (size_t i = chunk_slots_; i != 0; --i) {
+            chunk[i].next = free_;
+            free_ = &chunk[i];
+        }
+        if (chunk_slots_ < 4096) {
+            chunk_slots_ *= 2;
+        }
+        return true;
+    }
+};
+
+/// This allocator lets node-based containers, like `std::list` and
+/// `std::map`, take their nodes from a shared `m61_pool` per node type.
+/// Allocations of more than one object go to `m61_malloc`. The shared pool
+/// is never destroyed, so containers with static storage duration may
+/// still use it during exit; its chunks stay allocated until then.
+template <typename T>
+class m61_pool_allocator {
+public:
+    using value_type = T;
+    m61_pool_allocator() noexcept = default;
+    m61_pool_allocator(const m61_pool_allocator<T>&) noexcept = default;
+    template <typename U> m61_pool_allocator(const m61_pool_allocator<U>&) noexcept {}
+
+    T* allocate(size_t n) {
+        T* ptr = n == 1 ? pool().allocate() : reinterpret_cast<T*>(m61_malloc(n * sizeof(T), "?", 0));
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+    void deallocate(T* ptr, size_t n) {
+        if (n == 1) {
+            pool().deallocate(ptr);
+        } else {
+            m61_free_sized(ptr, n * sizeof(T), "?", 0);
+        }
+    }
+
+private:
+    static m61_pool<T>& pool() {
+        alignas(m61_pool<T>) static unsigned char storage[sizeof(m61_pool<T>)];
+        static m61_pool<T>* shared_pool = new (storage) m61_pool<T>("?", 0);
+        return *shared_pool;
+    }
+};
+template <typename T, typename U>
+inline constexpr bool operator==(const m61_pool_allocator<T>&, const m61_pool_allocator<U>&) {
+    return true;
+}
+
+/// m61_memory_resource
+///    Polymorphic memory resource that allocates from the m61 heap. The
+///    size and alignment passed to `deallocate` select the sized free and
+///    aligned allocation paths. Allocations are attributed to the source
+///    location where the resource was constructed.
+class m61_memory_resource : public std::pmr::memory_resource {
+public:
+    explicit m61_memory_resource(const char* file = __builtin_FILE(), int line = __builtin_LINE()) noexcept
+        : file_(file), line_(line) {
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* ptr = alignment <= alignof(std::max_align_t) ? m61_malloc(bytes, file_, line_)
+            : m61_aligned_alloc(alignment, bytes, file_, line_);
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+    void do_deallocate(void* ptr, size_t bytes, size_t) override {
+        m61_free_sized(ptr, bytes, file_, line_);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return dynamic_cast<const m61_memory_resource*>(&other) != nullptr;
+    }
+
+private:
+    const char* file_;
+    int line_;
+};
+
+/// m61_default_resource()
+///    Return a shared `m61_memory_resource`.
+m61_memory_resource* m61_default_resource();
+
+/// m61_monotonic_resource
+///    Polymorphic memory resource backed by an `m61_arena`. Deallocation is
+///    a no-op; `release()` frees everything at once.
+class m61_monotonic_resource : public std::pmr::memory_resource {
+public:
+    explicit m61_monotonic_resource(size_t chunk_size = 64 << 10, const char* file = __builtin_FILE(),
+                                    int line = __builtin_LINE())
+        : arena_(m61_arena_create(chunk_size, file, line)) {
+        if (!arena_) {
+            throw std::bad_alloc();
+        }
+    }
+    m61_monotonic_resource(const m61_monotonic_resource&) = delete;
+    m61_monotonic_resource& operator=(const m61_monotonic_resource&) = delete;
+    ~m61_monotonic_resource() override {
+        m61_arena_destroy(arena_);
+    }
+
+    /// Release all memory allocated from this resource.
+    void release() {
+        m61_arena_reset(arena_);
+    }
+
+protected:
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        void* ptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            ptr = m61_arena_alloc(arena_, bytes);
+        } else {
+            ptr = m61_arena_alloc(arena_, bytes + alignment - 1);
+            ptr = reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(ptr) + alignment - 1) & ~(alignment - 1));
+        }
+        if (!ptr) {
+            throw std::bad_alloc();
+        }
+        return ptr;
+    }
+    void do_deallocate(void*, size_t, size_t) override {
+    }
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+
+private:
+    m61_arena* arena_;
+};
+
+/// m61_pool_resource
+///    `std::pmr::unsynchronized_pool_resource` that takes its chunks from
+///    the m61 heap.
+class m61_pool_resource : public std::pmr::unsynchronized_pool_resource {
+public:
+    explicit m61_pool_resource(const std::pmr::pool_options& options = {})
+        : std::pmr::unsynchronized_pool_resource(options, m61_default_resource()) {
+    }
+};
+
 /// Returns a random integer between `min` and `max`, using randomness from
 /// `randomness`.
 template <typename Engine, typename T>
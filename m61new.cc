@@ -0,0 +1,102 @@
+#include "m61.hh"
+
+// Optional replacement of the global operator new and operator delete with
+// m61-backed implementations. Link this file into a C++ program to get m61
+// statistics and leak reports for every `new`. Sized delete (C++14) ignores
+// its size and goes through m61_free, since code outside our control may
+// pass a size that differs from the one it allocated; `std::align_val_t`
+// new (C++17) goes through m61_aligned_alloc.
+
+/// m61_operator_new(sz, alignment)
+///    Allocates memory for operator new, calling the new handler until the
+///    allocation succeeds. An allocation from the emergency reserve only
+///    counts as a success if there is no new handler: otherwise the handler
+///    first gets a chance to shed load, while its own allocations may still
+///    use the reserve. Returns `nullptr` if there is no new handler.
+static void* m61_operator_new(size_t sz, size_t alignment) {
+    while (true) {
+        void* ptr = alignment <= alignof(std::max_align_t) ? m61_malloc(sz, "?", 0)
+            : m61_aligned_alloc(alignment, sz, "?", 0);
+        std::new_handler handler = std::get_new_handler();
+        if (ptr && (!handler || !m61_is_emergency_allocation(ptr))) {
+            return ptr;
+        }
+        if (!handler) {
+            return nullptr;
+        }
+        m61_free(ptr, "?", 0);
+        handler();
+    }
+}
+
+void* operator new(size_t sz) {
+    if (void* ptr = m61_operator_new(sz, 0)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t sz) {
+    return operator new(sz);
+}
+void* operator new(size_t sz, const std::nothrow_t&) noexcept {
+    return m61_operator_new(sz, 0);
+}
+void* operator new[](size_t sz, const std::nothrow_t&) noexcept {
+    return m61_operator_new(sz, 0);
+}
+void* operator new(size_t sz, std::align_val_t alignment) {
+    if (void* ptr = m61_operator_new(sz, size_t(alignment))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t sz, std::align_val_t alignment) {
+    return operator new(sz, alignment);
+}
+void* operator new(size_t sz, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return m61_operator_new(sz, size_t(alignment));
+}
+void* operator new[](size_t sz, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return m61_operator_new(sz, size_t(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete[](void* ptr) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete(void* ptr, size_t sz) noexcept {
+    (void) sz;
+    m61_free(ptr, "?", 0);
+}
+void operator delete[](void* ptr, size_t sz) noexcept {
+    (void) sz;
+    m61_free(ptr, "?", 0);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete(void* ptr, size_t sz, std::align_val_t) noexcept {
+    (void) sz;
+    m61_free(ptr, "?", 0);
+}
+void operator delete[](void* ptr, size_t sz, std::align_val_t) noexcept {
+    (void) sz;
+    m61_free(ptr, "?", 0);
+}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    m61_free(ptr, "?", 0);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    m61_free(ptr, "?", 0);
+}
@@ -0,0 +1,233 @@
+#include "m61.hh"
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <unistd.h>
+
+// Shared-library shim that routes the C malloc family and the C++
+// operator new/delete family to m61. Build it with `make libm61.so` and run
+// a program with `LD_PRELOAD=./libm61.so`. The heap size can be set with
+// the M61_HEAP_SIZE environment variable.
+//
+// The shim never forwards to the libc allocator, so it needs no dlsym
+// lookups and cannot recurse through them. The m61 buffer is mapped on the
+// first allocation, which makes allocations before main safe. Every call
+// holds a recursive lock, since m61 itself is not thread-safe.
+
+#define EXPORT extern "C" __attribute__((visibility("default")))
+
+// Allocations made through the shim are attributed to this location
+static const char* const PRELOAD_FILE = "libm61.so";
+
+static pthread_mutex_t preload_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+/// preload_guard
+///    Holds `preload_lock` for its lifetime.
+struct preload_guard {
+    preload_guard() {
+        pthread_mutex_lock(&preload_lock);
+    }
+    ~preload_guard() {
+        pthread_mutex_unlock(&preload_lock);
+    }
+};
+
+/// lock_before_fork(), unlock_after_fork(), reset_after_fork()
+///    Fork handlers that hold `preload_lock` across `fork`, so the child's
+///    heap is never copied halfway through an operation of another thread.
+///    The child's thread is not the lock's owner, so it reinitializes the
+///    lock instead of unlocking it.
+static void lock_before_fork() {
+    pthread_mutex_lock(&preload_lock);
+}
+
+static void unlock_after_fork() {
+    pthread_mutex_unlock(&preload_lock);
+}
+
+static void reset_after_fork() {
+    preload_lock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+}
+
+__attribute__((constructor)) static void register_fork_handlers() {
+    pthread_atfork(lock_before_fork, unlock_after_fork, reset_after_fork);
+}
+
+EXPORT void* malloc(size_t sz) {
+    preload_guard guard;
+    void* ptr = m61_malloc(sz, PRELOAD_FILE, 0);
+    if (!ptr) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+EXPORT void free(void* ptr) {
+    preload_guard guard;
+    m61_free(ptr, PRELOAD_FILE, 0);
+}
+
+EXPORT void* calloc(size_t count, size_t sz) {
+    preload_guard guard;
+    void* ptr = m61_calloc(count, sz, PRELOAD_FILE, 0);
+    if (!ptr) {
+        errno = ENOMEM;
+    }
+    return ptr;
+}
+
+EXPORT void* realloc(void* ptr, size_t sz) {
+    preload_guard guard;
+    // Unlike m61_realloc, realloc(ptr, 0) frees `ptr`
+    if (sz == 0 && ptr) {
+        m61_free(ptr, PRELOAD_FILE, 0);
+        return nullptr;
+    }
+    void* new_ptr = m61_realloc(ptr, sz ? sz : 1, PRELOAD_FILE, 0);
+    if (!new_ptr) {
+        errno = ENOMEM;
+    }
+    return new_ptr;
+}
+
+EXPORT void* reallocarray(void* ptr, size_t count, size_t sz) {
+    if (sz && count > SIZE_MAX / sz) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return realloc(ptr, count * sz);
+}
+
+EXPORT int posix_memalign(void** p_ptr, size_t alignment, size_t sz) {
+    preload_guard guard;
+    return m61_posix_memalign(p_ptr, alignment, sz, PRELOAD_FILE, 0);
+}
+
+EXPORT void* aligned_alloc(size_t alignment, size_t sz) {
+    preload_guard guard;
+    void* ptr = m61_aligned_alloc(alignment, sz, PRELOAD_FILE, 0);
+    if (!ptr) {
+        errno = alignment == 0 || (alignment & (alignment - 1)) ? EINVAL : ENOMEM;
+    }
+    return ptr;
+}
+
+EXPORT void* memalign(size_t alignment, size_t sz) {
+    return aligned_alloc(alignment, sz);
+}
+
+EXPORT void* valloc(size_t sz) {
+    return aligned_alloc(sysconf(_SC_PAGESIZE), sz);
+}
+
+EXPORT void* pvalloc(size_t sz) {
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    if (sz > SIZE_MAX - page_size) {
+        errno = ENOMEM;
+        return nullptr;
+    }
+    return aligned_alloc(page_size, (sz + page_size - 1) & ~(page_size - 1));
+}
+
+EXPORT size_t malloc_usable_size(void* ptr) {
+    preload_guard guard;
+    return m61_malloc_usable_size(ptr);
+}
+
+
+/// preload_new(sz, alignment)
+///    Allocates memory for operator new, calling the new handler until the
+///    allocation succeeds. Returns `nullptr` if there is no new handler.
+static void* preload_new(size_t sz, size_t alignment) {
+    while (true) {
+        void* ptr;
+        {
+            preload_guard guard;
+            ptr = alignment <= alignof(std::max_align_t) ? m61_malloc(sz, PRELOAD_FILE, 0)
+                : m61_aligned_alloc(alignment, sz, PRELOAD_FILE, 0);
+        }
+        if (ptr) {
+            return ptr;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            return nullptr;
+        }
+        handler();
+    }
+}
+
+/// preload_delete(ptr)
+///    Frees memory for operator delete.
+static void preload_delete(void* ptr) noexcept {
+    preload_guard guard;
+    m61_free(ptr, PRELOAD_FILE, 0);
+}
+
+void* operator new(size_t sz) {
+    if (void* ptr = preload_new(sz, 0)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t sz) {
+    return operator new(sz);
+}
+void* operator new(size_t sz, const std::nothrow_t&) noexcept {
+    return preload_new(sz, 0);
+}
+void* operator new[](size_t sz, const std::nothrow_t&) noexcept {
+    return preload_new(sz, 0);
+}
+void* operator new(size_t sz, std::align_val_t alignment) {
+    if (void* ptr = preload_new(sz, size_t(alignment))) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+void* operator new[](size_t sz, std::align_val_t alignment) {
+    return operator new(sz, alignment);
+}
+void* operator new(size_t sz, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return preload_new(sz, size_t(alignment));
+}
+void* operator new[](size_t sz, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return preload_new(sz, size_t(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    preload_delete(ptr);
+}
+void operator delete[](void* ptr) noexcept {
+    preload_delete(ptr);
+}
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    preload_delete(ptr);
+}
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    preload_delete(ptr);
+}
+void operator delete(void* ptr, size_t) noexcept {
+    preload_delete(ptr);
+}
+void operator delete[](void* ptr, size_t) noexcept {
+    preload_delete(ptr);
+}
+void operator delete(void* ptr, std::align_val_t) noexcept {
+    preload_delete(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t) noexcept {
+    preload_delete(ptr);
+}
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept {
+    preload_delete(ptr);
+}
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept {
+    preload_delete(ptr);
+}
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    preload_delete(ptr);
+}
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept {
+    preload_delete(ptr);
+}
@@ -0,0 +1,48 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+// Check that a process that attaches to a shared heap on its own, rather
+// than by forking, can print the leak report: blocks allocated by another
+// image are reported without their source locations.
+
+int main(int argc, char** argv) {
+    if (argc == 2) {
+        // Attached process, started from scratch
+        bool attached = m61_shared_heap_attach(atoi(argv[1]));
+        assert(attached);
+        void* ptr = m61_malloc(200);
+        assert(ptr);
+        m61_print_leak_report();
+        fflush(stdout);
+        return 0;
+    }
+
+    int fd = m61_shared_heap_create(nullptr, 1 << 20);
+    assert(fd >= 0);
+    void* ptr = m61_malloc(100);
+    assert(ptr);
+    fflush(stdout);
+
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        char arg[32];
+        snprintf(arg, sizeof(arg), "%d", fd);
+        execl("/proc/self/exe", argv[0], arg, (char*) nullptr);
+        _exit(1);
+    }
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    m61_print_leak_report();
+}
+
+//! LEAK CHECK: test100.cc:17: allocated object ??{\w+}?? with size 200
+//! LEAK CHECK: ???:???: allocated object ??{\w+}?? with size 100
+//! LEAK CHECK: ???:???: allocated object ??{\w+}?? with size 200
+//! LEAK CHECK: test100.cc:26: allocated object ??{\w+}?? with size 100
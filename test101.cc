@@ -0,0 +1,38 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+// Check that a batch that does not fit in the heap takes the slow path:
+// the pressure callbacks release a cache, and the batch completes.
+
+static void* cache[16];
+static int ncallbacks = 0;
+
+static void drop_cache(m61_heap*, size_t, void*) {
+    ++ncallbacks;
+    for (void*& ptr : cache) {
+        m61_free(ptr);
+        ptr = nullptr;
+    }
+}
+
+int main() {
+    setenv("M61_HEAP_SIZE", "65536", 1);
+    m61_register_pressure_callback(drop_cache, nullptr);
+    for (void*& ptr : cache) {
+        ptr = m61_malloc(3000);
+        assert(ptr);
+    }
+
+    // The cache fills most of the heap, so only part of the batch fits
+    void* ptrs[24];
+    size_t n = m61_malloc_batch(1000, 24, ptrs);
+    m61_statistics stat = m61_get_statistics();
+    printf("%zu allocated, %llu failed, %d callbacks\n", n, stat.nfail, ncallbacks);
+    for (void* ptr : ptrs) {
+        assert(ptr && !m61_is_emergency_allocation(ptr));
+    }
+    m61_free_batch(ptrs, n);
+}
+
+//! 24 allocated, 0 failed, 1 callbacks
@@ -0,0 +1,27 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <source_location>
+// Check that m61_new_at, m61_new and m61_delete report their call sites.
+
+struct point {
+    int x, y;
+    point() : x(0), y(0) {}
+    point(int x_, int y_) : x(x_), y(y_) {}
+};
+
+int main() {
+    point* p = m61_new<point>();
+    point* q = m61_new_at<point>(std::source_location::current(), 3, 4);
+    assert(q->x == 3 && q->y == 4);
+    m61_print_leak_report();
+    fflush(stdout);
+    m61_delete(p);
+    m61_delete(q);
+    m61_delete(q);
+}
+
+//! LEAK CHECK: test102.cc:15: allocated object ??{0x\w+}?? with size 8
+//! LEAK CHECK: test102.cc:14: allocated object ??{0x\w+}?? with size 8
+//! MEMORY BUG: test102.cc:21: invalid free of pointer ??{0x\w+}??, double free
+//! ???
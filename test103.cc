@@ -0,0 +1,31 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <map>
+// Check that a container with static storage duration can release its
+// pool nodes during exit, after every pool would have been destroyed.
+
+using pool_map = std::map<int, int, std::less<int>, m61_pool_allocator<std::pair<const int, int>>>;
+
+struct exit_check {
+    ~exit_check() {
+        // Runs after `m` is destroyed, since it was constructed first
+        m61_statistics stat = m61_get_statistics();
+        printf("%llu frees at exit\n", stat.ntotal - stat.nactive);
+        void* ptr = m61_malloc(10);
+        assert(ptr);
+        m61_free(ptr);
+    }
+} check;
+
+pool_map m;
+
+int main() {
+    for (int i = 0; i != 1000; ++i) {
+        m[i] = i;
+    }
+    printf("%zu entries\n", m.size());
+}
+
+//! 1000 entries
+//! 0 frees at exit
@@ -0,0 +1,20 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check that the wild free report skips free blocks on its way to the
+// block that contains the pointer.
+
+int main() {
+    char* a = (char*) m61_malloc(1000);
+    char* b = (char*) m61_malloc(1000);
+    char* c = (char*) m61_malloc(1000);
+    m61_free(b);
+    (void) c;
+    fprintf(stderr, "Bad pointer %p\n", a + 64);
+    m61_free(a + 64);
+}
+
+//! Bad pointer ??{0x\w+}=ptr??
+//! MEMORY BUG: test104.cc:15: invalid free of pointer ??ptr??, not allocated
+//!   test104.cc:9: ??ptr?? is 64 bytes inside a 1000 byte region allocated here
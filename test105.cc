@@ -0,0 +1,33 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+// Check that allocations made from the private heap before a shared heap
+// was created are still freed and reallocated in the private heap.
+
+int main() {
+    void* p = m61_malloc(100);
+    char* q = (char*) m61_malloc(100);
+    strcpy(q, "private");
+
+    int fd = m61_shared_heap_create(nullptr, 1 << 20);
+    assert(fd >= 0);
+    void* s = m61_malloc(50);
+    assert(s);
+    m61_free(p);
+    q = (char*) m61_realloc(q, 5000);
+    assert(q && strcmp(q, "private") == 0);
+    m61_free(s);
+    m61_statistics stat = m61_get_statistics();
+    printf("shared: %llu active, %llu total\n", stat.nactive, stat.ntotal);
+
+    m61_shared_heap_detach();
+    close(fd);
+    stat = m61_get_statistics();
+    printf("private: %llu active, %llu total\n", stat.nactive, stat.ntotal);
+    m61_free(q);
+}
+
+//! shared: 0 active, 1 total
+//! private: 1 active, 3 total
@@ -0,0 +1,44 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+// Check that freeing emergency reserve allocations through a heap
+// instance, or while a shared heap is current, debits the private heap.
+
+int main() {
+    setenv("M61_HEAP_SIZE", "8192", 1);
+    void* ptrs[16];
+    int n = 0;
+    void* reserved[2];
+    int nreserved = 0;
+    while (nreserved != 2) {
+        void* ptr = m61_malloc(500);
+        assert(ptr && n != 16);
+        if (m61_is_emergency_allocation(ptr)) {
+            reserved[nreserved++] = ptr;
+        } else {
+            ptrs[n++] = ptr;
+        }
+    }
+    m61_statistics before = m61_get_statistics();
+
+    m61_heap* h = m61_heap_create(4096);
+    m61_heap_free(h, reserved[0]);
+    m61_statistics stat = m61_heap_get_statistics(h);
+    assert(stat.nactive == 0 && stat.active_size == 0);
+
+    int fd = m61_shared_heap_create(nullptr, 1 << 20);
+    assert(fd >= 0);
+    m61_free(reserved[1]);
+    stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+    m61_shared_heap_detach();
+
+    stat = m61_get_statistics();
+    printf("%llu fewer active, %llu fewer bytes\n", before.nactive - stat.nactive,
+           before.active_size - stat.active_size);
+    m61_heap_destroy(h);
+    m61_free_batch(ptrs, n);
+}
+
+//! 2 fewer active, 1000 fewer bytes
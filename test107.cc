@@ -0,0 +1,34 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check that growing the last block with m61_realloc respects the soft
+// limit: the block moves into a freed hole instead of growing the heap.
+
+int main() {
+    void* ptrs[10];
+    for (int i = 0; i != 10; ++i) {
+        ptrs[i] = m61_malloc(4000);
+    }
+    for (int i = 0; i < 10; i += 2) {
+        m61_free(ptrs[i]);
+    }
+    void* last = m61_malloc(1000);
+    m61_statistics stat = m61_get_statistics();
+    m61_set_soft_limit(stat.footprint + 1000);
+
+    void* grown = m61_realloc(last, 3000);
+    assert(grown && grown != last);
+    stat = m61_get_statistics();
+    assert(stat.footprint <= stat.soft_limit);
+    printf("moved under the soft limit\n");
+
+    m61_free(grown);
+    for (int i = 1; i < 10; i += 2) {
+        m61_free(ptrs[i]);
+    }
+    m61_print_statistics();
+}
+
+//! moved under the soft limit
+//! alloc count: active          0   total         12   fail          0
+//! alloc size:  active          0   total      44000   fail          0
@@ -0,0 +1,34 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+// Check that m61_aligned_alloc falls back to the emergency reserve when
+// the heap is exhausted, and that the reserve allocation is aligned.
+
+int main() {
+    setenv("M61_HEAP_SIZE", "8192", 1);
+    void* ptrs[16];
+    int n = 0;
+    void* ptr;
+    while ((ptr = m61_malloc(500)) && !m61_is_emergency_allocation(ptr)) {
+        assert(n != 16);
+        ptrs[n++] = ptr;
+    }
+    m61_free(ptr);
+
+    void* aligned = m61_aligned_alloc(256, 700);
+    assert(aligned && m61_is_emergency_allocation(aligned));
+    assert((uintptr_t) aligned % 256 == 0);
+    printf("aligned reserve allocation\n");
+
+    m61_free(aligned);
+    for (int i = 0; i != n; ++i) {
+        m61_free(ptrs[i]);
+    }
+    m61_print_statistics();
+}
+
+//! aligned reserve allocation
+//! alloc count: active          0   total        ???   fail          0
+//! alloc size:  active          0   total        ???   fail          0
@@ -0,0 +1,48 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <thread>
+// Check latency tracking from several threads on a shared heap, which is
+// locked, and of the aligned, batch and arena entry points.
+
+int main() {
+    int fd = m61_shared_heap_create(nullptr, 8 << 20);
+    assert(fd >= 0);
+    m61_set_latency_tracking(true);
+
+    std::thread threads[4];
+    for (auto& thread : threads) {
+        thread = std::thread([] {
+            for (int i = 0; i != 10000; ++i) {
+                m61_free(m61_malloc(i % 100 + 1));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    void* ptrs[100];
+    for (int i = 0; i != 10; ++i) {
+        m61_free(m61_aligned_alloc(256, 100));
+        size_t n = m61_malloc_batch(32, 100, ptrs);
+        assert(n == 100);
+        m61_free_batch(ptrs, n);
+    }
+    m61_arena* arena = m61_arena_create();
+    for (int i = 0; i != 1000; ++i) {
+        assert(m61_arena_alloc(arena, 16));
+    }
+    m61_arena_destroy(arena);
+    m61_set_latency_tracking(false);
+
+    m61_print_latency_report();
+}
+
+//! operation           count        p50        p90        p99      p99.9        max
+//! malloc              40002 ???
+//! free                40012 ???
+//! aligned_alloc          10 ???
+//! malloc_batch           10 ???
+//! free_batch             10 ???
+//! arena_alloc          1000 ???
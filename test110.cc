@@ -0,0 +1,53 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <unistd.h>
+#include <sys/wait.h>
+// Check that restoring a snapshot restores its allocation sites and keeps
+// the soft limit.
+
+int main() {
+    char path[] = "/tmp/m61test110.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    int fds[2];
+    int r = pipe(fds);
+    assert(r == 0);
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        void* ptrs[3];
+        for (int i = 0; i != 3; ++i) {
+            ptrs[i] = m61_malloc(100);
+        }
+        bool ok = m61_snapshot(path);
+        assert(ok);
+        ssize_t w = write(fds[1], ptrs, sizeof(ptrs));
+        assert(w == sizeof(ptrs));
+        _exit(0);
+    }
+    void* ptrs[3];
+    ssize_t n = read(fds[0], ptrs, sizeof(ptrs));
+    assert(n == sizeof(ptrs));
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // This process's sites are replaced by the snapshot's
+    m61_free(m61_malloc(10));
+    m61_set_soft_limit(1 << 20);
+    bool ok = m61_restore(path);
+    assert(ok);
+    unlink(path);
+    assert(m61_get_statistics().soft_limit == 1 << 20);
+
+    m61_free(ptrs[0]);
+    m61_print_site_report(5);
+    m61_free(ptrs[1]);
+    m61_free(ptrs[2]);
+}
+
+//!     active  active bytes       total   total bytes       frees  mean lifetime  site
+//!          2           200           3           300           1              ???  test110.cc:23
@@ -0,0 +1,42 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+// Check that releasing a mark takes the same time however many blocks it
+// drops, and that the statistics and sites are updated as by frees.
+
+static double time_release(int nblocks) {
+    double best = 1e9;
+    for (int round = 0; round != 5; ++round) {
+        m61_checkpoint mark = m61_mark();
+        for (int i = 0; i != nblocks; ++i) {
+            void* ptr = m61_malloc(i % 3 == 0 ? 20 : 40);
+            assert(ptr);
+        }
+        auto start = std::chrono::steady_clock::now();
+        m61_release(mark);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+int main() {
+    void* before = m61_malloc(100);
+    double few = time_release(10);
+    double many = time_release(50000);
+    printf("release of 10 blocks %.9fs, of 50000 blocks %.9fs\n", few, many);
+    assert(many < few * 10 + 1e-5);
+
+    m61_statistics stat = m61_get_statistics();
+    m61_size_histogram sizes = m61_get_size_histogram();
+    assert(stat.nactive == 1 && stat.active_size == 100);
+    assert(sizes.nactive[5] == 0 && sizes.nactive[6] == 0 && sizes.nactive[7] == 1);
+    m61_free(before);
+    m61_print_site_report(3);
+}
+
+//! release of 10 blocks ???s, of 50000 blocks ???s
+//!     active  active bytes       total   total bytes       frees  mean lifetime  site
+//!          0             0      250050      ???      250050 ???  test111.cc:13
+//!          0             0           1           100           1 ???  test111.cc:25
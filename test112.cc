@@ -0,0 +1,60 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <cinttypes>
+#include <unistd.h>
+// Check that reopening a cleanly closed persistent heap does not write to
+// its blocks: only the control block's page is dirtied.
+
+// Returns the number of dirty kilobytes of the mapping that contains `ptr`.
+static unsigned long dirty_kb(const void* ptr) {
+    FILE* f = fopen("/proc/self/smaps", "r");
+    assert(f);
+    char line[256];
+    bool in_mapping = false;
+    unsigned long kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        uintptr_t start, end;
+        unsigned long n;
+        if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR, &start, &end) == 2) {
+            in_mapping = start <= (uintptr_t) ptr && (uintptr_t) ptr < end;
+        } else if (in_mapping && (sscanf(line, "Shared_Dirty: %lu kB", &n) == 1
+                                  || sscanf(line, "Private_Dirty: %lu kB", &n) == 1)) {
+            kb += n;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+int main() {
+    char path[] = "/tmp/m61test112.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    bool opened = m61_persistent_heap_open(path, 8 << 20);
+    assert(opened);
+    void* first = nullptr;
+    for (int i = 0; i != 20000; ++i) {
+        void* ptr = m61_malloc(200);
+        assert(ptr);
+        if (i == 0) {
+            first = ptr;
+        }
+    }
+    m61_set_root(first);
+    m61_persistent_heap_close();
+
+    opened = m61_persistent_heap_open(path, 8 << 20);
+    assert(opened);
+    unsigned long kb = dirty_kb(m61_get_root());
+    printf("dirty after reopen: %s\n", kb <= 16 ? "control block only" : "blocks");
+    m61_persistent_heap_close();
+    unlink(path);
+}
+
+//! dirty after reopen: control block only
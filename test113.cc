@@ -0,0 +1,23 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check that M61_NEW attributes allocations to its call site, with and
+// without constructor arguments.
+
+struct point {
+    int x, y;
+    point() : x(0), y(0) {}
+    point(int x_, int y_) : x(x_), y(y_) {}
+};
+
+int main() {
+    point* p = M61_NEW(point);
+    point* q = M61_NEW(point, 3, 4);
+    assert(p->x == 0 && q->x == 3 && q->y == 4);
+    m61_print_leak_report();
+    m61_delete(p);
+    m61_delete(q);
+}
+
+//! LEAK CHECK: test113.cc:15: allocated object ??{0x\w+}?? with size 8
+//! LEAK CHECK: test113.cc:14: allocated object ??{0x\w+}?? with size 8
@@ -0,0 +1,43 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cerrno>
+#include <cstring>
+// Check aligned allocation: alignment, error handling, and statistics.
+
+int main() {
+    // Misalign the buffer frontier first
+    void* small = m61_malloc(24);
+    assert(small);
+
+    size_t alignments[] = {64, 4096, 2 << 20};
+    void* ptrs[3];
+    for (int i = 0; i != 3; ++i) {
+        ptrs[i] = m61_aligned_alloc(alignments[i], 1000);
+        assert(ptrs[i]);
+        assert(reinterpret_cast<uintptr_t>(ptrs[i]) % alignments[i] == 0);
+        memset(ptrs[i], 'A', 1000);
+    }
+
+    void* ptr = nullptr;
+    assert(m61_posix_memalign(&ptr, 3, 100) == EINVAL);
+    assert(ptr == nullptr);
+    assert(m61_posix_memalign(&ptr, 256, 100) == 0);
+    assert(reinterpret_cast<uintptr_t>(ptr) % 256 == 0);
+    assert(m61_memalign(48, 100) == nullptr);
+
+    m61_free(ptr);
+    for (int i = 0; i != 3; ++i) {
+        m61_free(ptrs[i]);
+    }
+    m61_free(small);
+
+    // The leading slack was returned to the heap along with the blocks
+    void* big = m61_malloc(7 << 20);
+    assert(big);
+    m61_free(big);
+    m61_print_statistics();
+}
+
+//! alloc count: active          0   total          6   fail          1
+//! alloc size:  active          0   total    7343156   fail        100
@@ -0,0 +1,49 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Measure the memory overhead of aligned allocations. The leading slack of
+// each aligned block must become a free block, so once the buffer is full,
+// ordinary allocations fill the gaps between aligned blocks.
+
+int main() {
+    size_t alignments[] = {64, 4096, 2 << 20};
+    for (size_t alignment : alignments) {
+        const int naligned = alignment == (2 << 20) ? 2 : 512;
+        void* aligned[512];
+        for (int i = 0; i != naligned; ++i) {
+            aligned[i] = m61_aligned_alloc(alignment, 100);
+            assert(aligned[i]);
+            assert(reinterpret_cast<uintptr_t>(aligned[i]) % alignment == 0);
+        }
+        uintptr_t aligned_end = reinterpret_cast<uintptr_t>(aligned[naligned - 1]);
+
+        // Fill the rest of the heap with 1000-byte allocations
+        static void* small[10000];
+        int nsmall = 0, nreused = 0;
+        while (nsmall != 10000 && (small[nsmall] = m61_malloc(1000))) {
+            nreused += reinterpret_cast<uintptr_t>(small[nsmall]) < aligned_end;
+            ++nsmall;
+        }
+        size_t payload = naligned * 100 + nsmall * 1000;
+        printf("alignment %zu: %d aligned, %d small (%d in slack), utilization %zu%%\n",
+               alignment, naligned, nsmall, nreused, payload * 100 / (8 << 20));
+        if (alignment > 64) {
+            assert(nreused > 0);
+        }
+
+        for (int i = 0; i != naligned; ++i) {
+            m61_free(aligned[i]);
+        }
+        for (int i = 0; i != nsmall; ++i) {
+            m61_free(small[i]);
+        }
+    }
+    m61_print_statistics();
+}
+
+//!!TIME
+//! alignment 64: 512 aligned, ??? small (??? in slack), utilization ???%
+//! alignment 4096: 512 aligned, ??? small (??? in slack), utilization ???%
+//! alignment 2097152: 2 aligned, ??? small (??? in slack), utilization ???%
+//! alloc count: active          0   total        ???   fail          3
+//! alloc size:  active          0   total        ???   fail       3000
@@ -0,0 +1,42 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <map>
+#include <vector>
+// Check sized free and standard containers that deallocate through it.
+
+int main() {
+    void* ptrs[10];
+    for (int i = 0; i != 10; ++i) {
+        ptrs[i] = m61_malloc(i * 10 + 1);
+        assert(ptrs[i]);
+    }
+    for (int i = 0; i != 10; i += 2) {
+        m61_free_sized(ptrs[i], i * 10 + 1);
+    }
+    m61_free_sized(nullptr, 100);
+    m61_print_statistics();
+
+    {
+        std::vector<int, m61_allocator<int>> v;
+        std::map<int, int, std::less<int>, m61_allocator<std::pair<const int, int>>> m;
+        for (int i = 0; i != 1000; ++i) {
+            v.push_back(i);
+            m[i] = i;
+        }
+        for (int i = 0; i != 1000; i += 2) {
+            m.erase(i);
+        }
+        assert(m.size() == 500);
+    }
+
+    for (int i = 1; i < 10; i += 2) {
+        m61_free_sized(ptrs[i], i * 10 + 1);
+    }
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0);
+    assert(stat.active_size == 0);
+}
+
+//! alloc count: active          5   total         10   fail          0
+//! alloc size:  active        255   total        460   fail          0
@@ -0,0 +1,13 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check that sized free detects a size mismatch.
+
+int main() {
+    void* ptr = m61_malloc(2001);
+    m61_free_sized(ptr, 2000);
+    m61_print_statistics();
+}
+
+//! MEMORY BUG???: invalid free of pointer ???, size 2000 does not match allocated size 2001
+//! ???
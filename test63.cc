@@ -0,0 +1,60 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check batch allocation and batch free, including reuse of freed blocks.
+
+int main() {
+    void* ptrs[100];
+    size_t n = m61_malloc_batch(100, 100, ptrs);
+    assert(n == 100);
+    for (int i = 0; i != 100; ++i) {
+        assert(ptrs[i]);
+        memset(ptrs[i], i, 100);
+        if (i) {
+            assert((char*) ptrs[i - 1] + 100 <= (char*) ptrs[i]);
+        }
+    }
+    m61_print_statistics();
+
+    // Free every other block; the batch skips null entries
+    void* odd[100] = {};
+    for (int i = 1; i < 100; i += 2) {
+        odd[i] = ptrs[i];
+    }
+    m61_free_batch(odd, 100);
+    m61_print_statistics();
+
+    // Fill the buffer, then a batch must come from the freed blocks
+    void* big = m61_malloc((8 << 20) - 17620);
+    assert(big);
+    // (the last block went back to the buffer, leaving 49 holes)
+    void* again[49];
+    n = m61_malloc_batch(100, 49, again);
+    assert(n == 49);
+    for (int i = 0; i != 49; ++i) {
+        assert(again[i] >= ptrs[0] && again[i] < big);
+    }
+
+    // Too many blocks: the rest fail
+    void* many[1000];
+    n = m61_malloc_batch(100, 1000, many);
+    assert(n < 1000);
+    assert(many[999] == nullptr);
+    m61_free_batch(many, n);
+
+    m61_free_batch(again, 49);
+    m61_free(big);
+    for (int i = 0; i < 100; i += 2) {
+        m61_free(ptrs[i]);
+    }
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+    printf("fail %llu\n", stat.nfail + n);
+}
+
+//! alloc count: active        100   total        100   fail          0
+//! alloc size:  active      10000   total      10000   fail          0
+//! alloc count: active         50   total        100   fail          0
+//! alloc size:  active       5000   total      10000   fail          0
+//! fail 1000
@@ -0,0 +1,40 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+// Compare batch allocation and free against the same work done with
+// individual m61_malloc and m61_free calls.
+
+int main() {
+    const int nbatch = 256;
+    const int rounds = 4000;
+    void* ptrs[nbatch];
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r != rounds; ++r) {
+        for (int i = 0; i != nbatch; ++i) {
+            ptrs[i] = m61_malloc(48);
+            assert(ptrs[i]);
+        }
+        for (int i = nbatch; i != 0; --i) {
+            m61_free(ptrs[i - 1]);
+        }
+    }
+    std::chrono::duration<double> individual = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r != rounds; ++r) {
+        size_t n = m61_malloc_batch(48, nbatch, ptrs);
+        assert(n == nbatch);
+        m61_free_batch(ptrs, nbatch);
+    }
+    std::chrono::duration<double> batch = std::chrono::steady_clock::now() - start;
+
+    printf("individual %.3fs, batch %.3fs\n", individual.count(), batch.count());
+    m61_print_statistics();
+}
+
+//!!TIME
+//! individual ???s, batch ???s
+//! alloc count: active          0   total    2048000   fail          0
+//! alloc size:  active          0   total   98304000   fail          0
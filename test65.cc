@@ -0,0 +1,50 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check in-place realloc: growing at the buffer end, growing into a free
+// successor, and shrinking.
+
+int main() {
+    // Growing the last block extends the buffer position
+    char* a = (char*) m61_malloc(100);
+    memset(a, 'a', 100);
+    char* a2 = (char*) m61_realloc(a, 5000);
+    assert(a2 == a);
+    for (int i = 0; i != 100; ++i) {
+        assert(a2[i] == 'a');
+    }
+
+    // Growing into a free successor
+    char* b = (char*) m61_malloc(1000);
+    char* c = (char*) m61_malloc(1000);
+    char* d = (char*) m61_malloc(10);
+    memset(b, 'b', 1000);
+    m61_free(c);
+    char* b2 = (char*) m61_realloc(b, 1800);
+    assert(b2 == b);
+    for (int i = 0; i != 1000; ++i) {
+        assert(b2[i] == 'b');
+    }
+
+    // The successor is too small: the block moves
+    char* b3 = (char*) m61_realloc(b2, 4000);
+    assert(b3 != b2);
+    for (int i = 0; i != 1000; ++i) {
+        assert(b3[i] == 'b');
+    }
+
+    // Shrinking splits off a free tail, which the block can grow back into
+    char* a3 = (char*) m61_realloc(a2, 50);
+    assert(a3 == a2);
+    char* e = (char*) m61_realloc(a3, 4900);
+    assert(e == a3);
+
+    m61_free(b3);
+    m61_free(d);
+    m61_free(e);
+    m61_print_statistics();
+}
+
+//! alloc count: active          0   total          9   fail          0
+//! alloc size:  active          0   total      17860   fail          0
@@ -0,0 +1,59 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Simulate vector push_back growth with m61_realloc and count how often the
+// data has to move. One vector at the end of the buffer never moves; two
+// vectors growing side by side move only when the other is in the way.
+
+struct vec {
+    int* data = nullptr;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t moves = 0;
+    size_t bytes_moved = 0;
+
+    void push_back(int x) {
+        if (size == capacity) {
+            capacity = capacity ? capacity * 2 : 4;
+            int* data2 = (int*) m61_realloc(data, capacity * sizeof(int));
+            assert(data2);
+            if (data && data2 != data) {
+                ++moves;
+                bytes_moved += size * sizeof(int);
+            }
+            data = data2;
+        }
+        data[size++] = x;
+    }
+};
+
+int main() {
+    vec v;
+    for (int i = 0; i != 1000000; ++i) {
+        v.push_back(i);
+    }
+    for (int i = 0; i != 1000000; ++i) {
+        assert(v.data[i] == i);
+    }
+    printf("one vector: %zu moves, %zu bytes moved\n", v.moves, v.bytes_moved);
+    m61_free(v.data);
+
+    vec v1, v2;
+    for (int i = 0; i != 200000; ++i) {
+        v1.push_back(i);
+        v2.push_back(-i);
+    }
+    for (int i = 0; i != 200000; ++i) {
+        assert(v1.data[i] == i && v2.data[i] == -i);
+    }
+    printf("two vectors: %zu moves, %zu bytes moved\n", v1.moves + v2.moves, v1.bytes_moved + v2.bytes_moved);
+    m61_free(v1.data);
+    m61_free(v2.data);
+    m61_print_statistics();
+}
+
+//!!TIME
+//! one vector: 0 moves, 0 bytes moved
+//! two vectors: ??? moves, ??? bytes moved
+//! alloc count: active          0   total        ???   fail          0
+//! alloc size:  active          0   total        ???   fail          0
@@ -0,0 +1,51 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check arena allocation, reset, destroy, statistics and leak reporting.
+
+int main() {
+    m61_arena* arena = m61_arena_create(4096);
+    assert(arena);
+
+    char* ptrs[100];
+    for (int i = 0; i != 100; ++i) {
+        ptrs[i] = (char*) m61_arena_alloc(arena, 100);
+        assert(ptrs[i]);
+        assert(reinterpret_cast<uintptr_t>(ptrs[i]) % alignof(std::max_align_t) == 0);
+        memset(ptrs[i], i, 100);
+    }
+    for (int i = 0; i != 100; ++i) {
+        for (int j = 0; j != 100; ++j) {
+            assert(ptrs[i][j] == (char) i);
+        }
+    }
+    char* big = (char*) m61_arena_alloc(arena, 10000);
+    assert(big);
+    memset(big, 'x', 10000);
+
+    // The arena object and its chunks are heap allocations
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive > 2);
+
+    // Reset keeps only one chunk
+    m61_arena_reset(arena);
+    stat = m61_get_statistics();
+    assert(stat.nactive == 2);
+    assert(m61_arena_alloc(arena, 100));
+    assert(m61_get_statistics().nactive == 2);
+
+    m61_arena_destroy(arena);
+    m61_arena_destroy(nullptr);
+    stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+
+    // An arena that is never destroyed is reported as leaked
+    m61_arena* leaked = m61_arena_create(1000);
+    m61_arena_alloc(leaked, 10);
+    m61_print_leak_report();
+}
+
+//!!UNORDERED
+//! LEAK CHECK: test???.cc:44: allocated object ??{\w+}?? with size 24
+//! LEAK CHECK: test???.cc:44: allocated object ??{\w+}?? with size 1016
@@ -0,0 +1,49 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+// Compare per-request allocation through an arena against allocating and
+// freeing the same objects individually.
+
+int main() {
+    const int nrequests = 20000;
+    const int nobjects = 50;
+    void* ptrs[nobjects];
+    std::default_random_engine randomness(61);
+    size_t sizes[nobjects];
+    for (int i = 0; i != nobjects; ++i) {
+        sizes[i] = uniform_int(size_t(16), size_t(256), randomness);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r != nrequests; ++r) {
+        for (int i = 0; i != nobjects; ++i) {
+            ptrs[i] = m61_malloc(sizes[i]);
+            assert(ptrs[i]);
+        }
+        for (int i = 0; i != nobjects; ++i) {
+            m61_free(ptrs[i]);
+        }
+    }
+    std::chrono::duration<double> individual = std::chrono::steady_clock::now() - start;
+
+    m61_arena* arena = m61_arena_create();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r != nrequests; ++r) {
+        for (int i = 0; i != nobjects; ++i) {
+            ptrs[i] = m61_arena_alloc(arena, sizes[i]);
+            assert(ptrs[i]);
+        }
+        m61_arena_reset(arena);
+    }
+    std::chrono::duration<double> arena_time = std::chrono::steady_clock::now() - start;
+    m61_arena_destroy(arena);
+
+    printf("individual %.3fs, arena %.3fs\n", individual.count(), arena_time.count());
+    m61_print_statistics();
+}
+
+//!!TIME
+//! individual ???s, arena ???s
+//! alloc count: active          0   total    1000002   fail          0
+//! alloc size:  active          0   total        ???   fail          0
@@ -0,0 +1,51 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <list>
+#include <map>
+// Check m61_pool slot reuse and node containers using m61_pool_allocator.
+
+struct point {
+    double x, y, z;
+};
+
+int main() {
+    {
+        m61_pool<point> pool;
+        point* ptrs[100];
+        for (int i = 0; i != 100; ++i) {
+            ptrs[i] = pool.allocate();
+            assert(ptrs[i]);
+            ptrs[i]->x = ptrs[i]->y = ptrs[i]->z = i;
+        }
+        for (int i = 0; i != 100; ++i) {
+            assert(ptrs[i]->x == i && ptrs[i]->z == i);
+        }
+        // Slots are packed without headers
+        assert(ptrs[1] == ptrs[0] + 1);
+        // Freed slots are reused
+        pool.deallocate(ptrs[50]);
+        assert(pool.allocate() == ptrs[50]);
+        for (int i = 0; i != 100; ++i) {
+            pool.deallocate(ptrs[i]);
+        }
+    }
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0);
+
+    std::list<int, m61_pool_allocator<int>> l;
+    std::map<int, int, std::less<int>, m61_pool_allocator<std::pair<const int, int>>> m;
+    for (int i = 0; i != 10000; ++i) {
+        l.push_back(i);
+        m[i] = -i;
+    }
+    for (int i = 0; i != 10000; i += 2) {
+        m.erase(i);
+    }
+    l.remove_if([] (int x) { return x % 3 == 0; });
+    assert(m.size() == 5000 && m[9999] == -9999);
+    assert(l.size() == 6666);
+    printf("OK\n");
+}
+
+//! OK
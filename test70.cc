@@ -0,0 +1,45 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+#include <map>
+// Compare std::map<int, int> insert/erase with std::allocator,
+// m61_allocator and m61_pool_allocator. For the m61-backed maps, also report
+// the peak number of heap blocks and payload bytes; every heap block
+// carries a header, so fewer blocks means less overhead.
+
+template <typename Map>
+static void run(const char* name) {
+    std::default_random_engine randomness(61);
+    m61_statistics before = m61_get_statistics();
+    auto start = std::chrono::steady_clock::now();
+    unsigned long long peak_count = 0, peak_size = 0;
+    {
+        Map m;
+        for (int round = 0; round != 10; ++round) {
+            for (int i = 0; i != 20000; ++i) {
+                m[uniform_int(0, 1 << 14, randomness)] = i;
+            }
+            m61_statistics stat = m61_get_statistics();
+            peak_count = std::max(peak_count, stat.nactive - before.nactive);
+            peak_size = std::max(peak_size, stat.active_size - before.active_size);
+            for (int i = 0; i != 20000; ++i) {
+                m.erase(uniform_int(0, 1 << 14, randomness));
+            }
+        }
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    printf("%s: %.3fs, peak m61 blocks %llu, bytes %llu\n", name, elapsed.count(), peak_count, peak_size);
+}
+
+int main() {
+    using pair = std::pair<const int, int>;
+    run<std::map<int, int>>("std::allocator");
+    run<std::map<int, int, std::less<int>, m61_allocator<pair>>>("m61_allocator");
+    run<std::map<int, int, std::less<int>, m61_pool_allocator<pair>>>("m61_pool_allocator");
+}
+
+//!!TIME
+//! std::allocator: ???s, peak m61 blocks 0, bytes 0
+//! m61_allocator: ???s, peak m61 blocks ???, bytes ???
+//! m61_pool_allocator: ???s, peak m61 blocks ???, bytes ???
@@ -0,0 +1,62 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <map>
+#include <memory_resource>
+#include <vector>
+// Check the m61 polymorphic memory resources.
+
+struct alignas(64) cache_line {
+    char data[64];
+};
+
+int main() {
+    m61_memory_resource resource;
+    {
+        std::pmr::vector<int> v(&resource);
+        std::pmr::map<int, int> m(&resource);
+        for (int i = 0; i != 1000; ++i) {
+            v.push_back(i);
+            m[i] = i;
+        }
+        assert(m61_get_statistics().nactive > 1000);
+
+        // Over-aligned allocations take the aligned path
+        void* ptr = resource.allocate(100, 4096);
+        assert(reinterpret_cast<uintptr_t>(ptr) % 4096 == 0);
+        resource.deallocate(ptr, 100, 4096);
+    }
+    assert(m61_get_statistics().nactive == 0);
+    assert(resource.is_equal(*m61_default_resource()));
+
+    {
+        m61_monotonic_resource monotonic(4096);
+        std::pmr::vector<cache_line> v(&monotonic);
+        for (int i = 0; i != 100; ++i) {
+            v.emplace_back();
+            assert(reinterpret_cast<uintptr_t>(&v.back()) % 64 == 0);
+        }
+        monotonic.release();
+        assert(m61_get_statistics().nactive == 2);
+    }
+
+    {
+        m61_pool_resource pool;
+        std::pmr::map<int, int> m(&pool);
+        for (int i = 0; i != 1000; ++i) {
+            m[i] = i;
+        }
+        assert(m61_get_statistics().nactive < 100);
+    }
+
+    // m61_allocator handles over-aligned types
+    {
+        std::vector<cache_line, m61_allocator<cache_line>> v;
+        v.resize(10);
+        assert(reinterpret_cast<uintptr_t>(v.data()) % 64 == 0);
+    }
+    m61_print_statistics();
+}
+
+//! alloc count: active          0   total        ???   fail          0
+//! alloc size:  active          0   total        ???   fail          0
@@ -0,0 +1,22 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <vector>
+// Check that an m61_allocator constructed from a source location attributes
+// allocations to it, and that a default-constructed one attributes them to
+// the unknown site.
+
+int main() {
+    std::vector<int, m61_allocator<int>> v(m61_allocator<int>(std::source_location::current()));
+    v.push_back(1);
+    m61_allocator<long> allocator(std::source_location::current());
+    auto* leaked = new std::vector<long, m61_allocator<long>>(10, 0, allocator);
+    (void) leaked;
+    std::vector<char, m61_allocator<char>> unattributed(3);
+    m61_print_leak_report();
+}
+
+//!!UNORDERED
+//! LEAK CHECK: test???.cc:10: allocated object ??{\w+}?? with size 4
+//! LEAK CHECK: test???.cc:12: allocated object ??{\w+}?? with size 80
+//! LEAK CHECK: ?:0: allocated object ??{\w+}?? with size 3
@@ -0,0 +1,57 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+// Check the operator new/delete replacement in m61new.cc: plain, array,
+// sized and aligned forms all go through the m61 heap.
+
+struct alignas(256) aligned_block {
+    char data[300];
+};
+
+struct object {
+    virtual ~object() = default;
+    long values[10];
+};
+
+int main() {
+    m61_statistics before = m61_get_statistics();
+
+    int* x = new int(61);
+    object* o = new object;
+    char* array = new char[1000];
+    aligned_block* a = new aligned_block;
+    aligned_block* as = new aligned_block[3];
+    assert(reinterpret_cast<uintptr_t>(a) % 256 == 0);
+    assert(reinterpret_cast<uintptr_t>(as) % 256 == 0);
+
+    // Keep the compiler from eliding the allocations
+    void* volatile escape[] = {x, o, array, a, as};
+    (void) escape;
+
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive - before.nactive == 5);
+
+    delete x;
+    delete o;
+    delete[] array;
+    delete a;
+    delete[] as;
+    {
+        std::vector<std::string> v;
+        for (int i = 0; i != 100; ++i) {
+            v.push_back(std::string(100, 'x'));
+        }
+        auto p = std::make_unique<aligned_block>();
+        assert(m61_get_statistics().nactive > before.nactive + 100);
+    }
+
+    stat = m61_get_statistics();
+    assert(stat.nactive == before.nactive);
+    assert(stat.ntotal > before.ntotal + 100);
+    printf("OK\n");
+}
+
+//! OK
@@ -0,0 +1,53 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <string>
+// Check m61_new and m61_delete: construction, alignment, exceptions and
+// statistics.
+
+struct point {
+    int x, y;
+    point(int x_, int y_) : x(x_), y(y_) {}
+};
+
+struct alignas(128) wide {
+    char data[200];
+};
+
+struct thrower {
+    thrower() {
+        throw 61;
+    }
+};
+
+static_assert(m61_block_size(1) == sizeof(header) + 16);
+static_assert(m61_block_size(8) == sizeof(header) + 16);
+static_assert(m61_block_size(9) == sizeof(header) + 32);
+
+int main() {
+    point* p = m61_new<point>(3, 4);
+    assert(p->x == 3 && p->y == 4);
+    std::string* s = m61_new<std::string>(10, 'x');
+    assert(*s == "xxxxxxxxxx");
+    wide* w = m61_new<wide>();
+    assert(reinterpret_cast<uintptr_t>(w) % 128 == 0);
+
+    try {
+        m61_new<thrower>();
+        assert(false);
+    } catch (int x) {
+        assert(x == 61);
+    }
+
+    m61_print_statistics();
+    m61_delete(p);
+    m61_delete(s);
+    m61_delete(w);
+    m61_delete<point>(nullptr);
+    m61_print_statistics();
+}
+
+//! alloc count: active          3   total          4   fail          0
+//! alloc size:  active        ???   total        ???   fail          0
+//! alloc count: active          0   total          4   fail          0
+//! alloc size:  active          0   total        ???   fail          0
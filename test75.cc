@@ -0,0 +1,49 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+// Compare m61_new/m61_delete, whose block size is computed at compile time,
+// with m61_malloc/m61_free of the same size.
+
+struct node {
+    node* next;
+    long value;
+    char name[24];
+};
+
+int main() {
+    const int nptrs = 128;
+    node* ptrs[nptrs] = {};
+
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i != 1000000; ++i) {
+        int slot = i % nptrs;
+        m61_free(ptrs[slot]);
+        ptrs[slot] = (node*) m61_malloc(sizeof(node));
+        assert(ptrs[slot]);
+    }
+    for (int i = 0; i != nptrs; ++i) {
+        m61_free(ptrs[i]);
+        ptrs[i] = nullptr;
+    }
+    std::chrono::duration<double> runtime_size = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i != 1000000; ++i) {
+        int slot = i % nptrs;
+        m61_delete(ptrs[slot]);
+        ptrs[slot] = m61_new<node>();
+    }
+    for (int i = 0; i != nptrs; ++i) {
+        m61_delete(ptrs[i]);
+    }
+    std::chrono::duration<double> constant_size = std::chrono::steady_clock::now() - start;
+
+    printf("m61_malloc %.3fs, m61_new %.3fs\n", runtime_size.count(), constant_size.count());
+    m61_print_statistics();
+}
+
+//!!TIME
+//! m61_malloc ???s, m61_new ???s
+//! alloc count: active          0   total    2000000   fail          0
+//! alloc size:  active          0   total   80000000   fail          0
@@ -0,0 +1,55 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check lifetime-hinted allocation: long-lived blocks grow down from the end
+// of the buffer, short-lived blocks grow up from its start.
+
+int main() {
+    char* a = (char*) m61_malloc(100);
+    char* l1 = (char*) m61_malloc_hint(1000, M61_LONG_LIVED);
+    char* l2 = (char*) m61_malloc_hint(1000, M61_LONG_LIVED);
+    char* b = (char*) m61_malloc_hint(100, M61_SHORT_LIVED);
+    assert(a && l1 && l2 && b);
+    assert(a < b && b < l2 && l2 < l1);
+    memset(l1, 1, 1000);
+    memset(l2, 2, 1000);
+
+    // Freeing the lowest long-lived block returns its space
+    m61_free(l2);
+    char* l3 = (char*) m61_malloc_hint(1000, M61_LONG_LIVED);
+    assert(l3 == l2);
+
+    // A moved long-lived block stays in the long-lived region
+    m61_free(l3);
+    char* c = (char*) m61_malloc(3000);
+    char* l4 = (char*) m61_realloc(l1, 3000);
+    assert(l4 != l1 && l4 > c);
+    for (int i = 0; i != 1000; ++i) {
+        assert(l4[i] == 1);
+    }
+
+    // Fill the gap between the regions completely, then free everything
+    void* fill[64];
+    int nfill = 0;
+    while ((fill[nfill] = m61_malloc(1 << 17))) {
+        ++nfill;
+    }
+    m61_free(a);
+    m61_free(b);
+    m61_free(c);
+    m61_free(l4);
+    for (int i = 0; i != nfill; ++i) {
+        m61_free(fill[i]);
+    }
+
+    // The whole buffer is available again
+    void* big = m61_malloc((8 << 20) - 1000);
+    assert(big);
+    m61_free(big);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+    printf("OK\n");
+}
+
+//! OK
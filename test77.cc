@@ -0,0 +1,67 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <algorithm>
+// Measure fragmentation on a mixed-lifetime workload with and without
+// lifetime hints. Long-lived cache entries are allocated in between
+// short-lived temporaries. After the temporaries are freed, report the
+// address span of the surviving entries and the largest block that can
+// still be allocated.
+
+static size_t largest_allocation() {
+    size_t lo = 0, hi = 8 << 20;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        if (void* ptr = m61_malloc(mid)) {
+            m61_free(ptr);
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+static void run(const char* name, int long_hint, int short_hint) {
+    std::default_random_engine randomness(61);
+    const int ntemps = 256;
+    void* temps[ntemps] = {};
+    const int nentries = 2000;
+    void* entries[nentries];
+    int nentry = 0;
+
+    for (int i = 0; i != 20000; ++i) {
+        int slot = uniform_int(0, ntemps - 1, randomness);
+        m61_free(temps[slot]);
+        temps[slot] = m61_malloc_hint(uniform_int(100, 2000, randomness), short_hint);
+        assert(temps[slot]);
+        if (i % 10 == 0) {
+            entries[nentry] = m61_malloc_hint(256, long_hint);
+            assert(entries[nentry]);
+            ++nentry;
+        }
+    }
+    for (int i = 0; i != ntemps; ++i) {
+        m61_free(temps[i]);
+    }
+
+    auto minmax = std::minmax_element(entries, entries + nentry);
+    size_t span = (char*) *minmax.second - (char*) *minmax.first + 256;
+    printf("%s: %d entries, span %zu bytes, largest free allocation %zu bytes\n",
+           name, nentry, span, largest_allocation());
+
+    for (int i = 0; i != nentry; ++i) {
+        m61_free(entries[i]);
+    }
+}
+
+int main() {
+    run("no hints", 0, 0);
+    run("hints", M61_LONG_LIVED, M61_SHORT_LIVED);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0);
+}
+
+//!!TIME
+//! no hints: 2000 entries, span ??? bytes, largest free allocation ??? bytes
+//! hints: 2000 entries, span ??? bytes, largest free allocation ??? bytes
@@ -0,0 +1,59 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check lifetime prediction: once a site has shown that its blocks live
+// long, its unhinted allocations are placed in the long-lived region, while
+// sites with short lifetimes and unknown sites stay in the default region.
+
+static void* short_site() {
+    return m61_malloc(100);
+}
+
+static void* long_site() {
+    return m61_malloc(100);
+}
+
+int main() {
+    // Blocks of the long site survive thousands of short-lived allocations
+    void* survivors[8];
+    for (int i = 0; i != 8; ++i) {
+        survivors[i] = long_site();
+        assert(survivors[i]);
+    }
+    void* first = survivors[0];
+    for (int i = 0; i != 5000; ++i) {
+        void* ptr = short_site();
+        assert(ptr);
+        m61_free(ptr);
+    }
+    for (int i = 0; i != 8; ++i) {
+        m61_free(survivors[i]);
+    }
+
+    // The short site and an unknown site grow up from the start of the buffer
+    char* s = (char*) short_site();
+    char* u = (char*) m61_malloc(100);
+    assert(s == first && s < u);
+
+    // The long site now behaves as if hinted M61_LONG_LIVED
+    char* l = (char*) long_site();
+    char* h = (char*) m61_malloc_hint(100, M61_LONG_LIVED);
+    assert(u < h && h < l);
+
+    // Without prediction, the long site is placed like any other allocation
+    m61_set_lifetime_prediction(false);
+    char* l2 = (char*) long_site();
+    assert(u < l2 && l2 < h);
+    m61_set_lifetime_prediction(true);
+
+    m61_free(s);
+    m61_free(u);
+    m61_free(l);
+    m61_free(h);
+    m61_free(l2);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+    printf("OK\n");
+}
+
+//! OK
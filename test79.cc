@@ -0,0 +1,47 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check mark/release: releasing a mark frees everything allocated since it
+// was taken, adjusts the statistics and reports allocations that escape.
+
+int main() {
+    void* before = m61_malloc(100);
+    m61_checkpoint mark = m61_mark();
+
+    void* ptrs[100];
+    for (int i = 0; i != 100; ++i) {
+        ptrs[i] = m61_malloc(i * 10 + 1);
+        assert(ptrs[i]);
+        memset(ptrs[i], i, i * 10 + 1);
+    }
+
+    // Marks nest
+    m61_checkpoint inner = m61_mark();
+    void* x = m61_malloc(1000);
+    m61_release(inner);
+    void* y = m61_malloc(1000);
+    assert(y == x);
+
+    // Allocations made since the mark may still be freed one by one
+    m61_free(ptrs[50]);
+    void* escaped = m61_malloc_hint(100, M61_LONG_LIVED);
+
+    m61_release(mark);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 2 && stat.active_size == 200);
+
+    // The released memory is reused
+    void* after = m61_malloc(100);
+    assert(after == ptrs[0]);
+
+    m61_free(after);
+    m61_free(escaped);
+    m61_free(before);
+    stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+    printf("OK\n");
+}
+
+//! MARK CHECK: test79.cc:28: allocated object ??{0x\w+}?? with size 100 escapes the mark released at test79.cc:30
+//! OK
@@ -0,0 +1,59 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+// Compare releasing a mark with freeing the same objects one by one, on
+// parser-like phases that each build and then drop many small nodes. Only
+// the time spent dropping the nodes is measured.
+
+struct node {
+    node* next;
+    char data[];
+};
+
+static const int nphases = 100;
+static const int nnodes = 20000;
+
+static node* build(std::default_random_engine& randomness) {
+    node* list = nullptr;
+    for (int i = 0; i != nnodes; ++i) {
+        node* n = (node*) m61_malloc(sizeof(node) + uniform_int(8, 120, randomness));
+        assert(n);
+        n->next = list;
+        list = n;
+    }
+    return list;
+}
+
+int main() {
+    std::default_random_engine randomness(61);
+    std::chrono::duration<double> individual(0);
+    for (int phase = 0; phase != nphases; ++phase) {
+        node* list = build(randomness);
+        auto start = std::chrono::steady_clock::now();
+        while (list) {
+            node* next = list->next;
+            m61_free(list);
+            list = next;
+        }
+        individual += std::chrono::steady_clock::now() - start;
+    }
+
+    randomness.seed(61);
+    std::chrono::duration<double> released(0);
+    for (int phase = 0; phase != nphases; ++phase) {
+        m61_checkpoint mark = m61_mark();
+        build(randomness);
+        auto start = std::chrono::steady_clock::now();
+        m61_release(mark);
+        released += std::chrono::steady_clock::now() - start;
+    }
+
+    printf("m61_free %.3fs, m61_release %.3fs\n", individual.count(), released.count());
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.active_size == 0);
+    assert(stat.ntotal == 2 * nphases * nnodes);
+}
+
+//!!TIME
+//! m61_free ???s, m61_release ???s
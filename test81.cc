@@ -0,0 +1,78 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+// Check the shared heap: a child process frees a block allocated by its
+// parent and hands a new allocation back by offset, and the heap can be
+// reattached at a different address.
+
+int main() {
+    int fd = m61_shared_heap_create(nullptr, 1 << 20);
+    assert(fd >= 0);
+    char* greeting = (char*) m61_malloc(100);
+    strcpy(greeting, "hello from the parent");
+
+    int fds[2];
+    int r = pipe(fds);
+    assert(r == 0);
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        assert(strcmp(greeting, "hello from the parent") == 0);
+        m61_free(greeting);
+        char* reply = (char*) m61_malloc(100);
+        strcpy(reply, "hello from the child");
+        size_t offset = m61_shared_offset(reply);
+
+        // Reattach the object as an unrelated process would, with its
+        // original address already taken
+        m61_shared_heap_detach();
+        uintptr_t page = (uintptr_t) reply & ~(uintptr_t) 4095;
+        void* blocker = mmap((void*) page, 4096, PROT_NONE,
+                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        assert(blocker == (void*) page);
+        bool attached = m61_shared_heap_attach(fd);
+        assert(attached);
+        char* moved = (char*) m61_shared_pointer(offset);
+        assert(moved != reply);
+        assert(strcmp(moved, "hello from the child") == 0);
+
+        // The heap's links still work at the new address
+        void* ptr = m61_malloc(200);
+        assert(ptr);
+        m61_free(ptr);
+
+        ssize_t w = write(fds[1], &offset, sizeof(offset));
+        assert(w == sizeof(offset));
+        _exit(0);
+    }
+
+    size_t offset;
+    ssize_t n = read(fds[0], &offset, sizeof(offset));
+    assert(n == sizeof(offset));
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // The child's allocation and free are visible in the shared statistics
+    char* reply = (char*) m61_shared_pointer(offset);
+    printf("%s\n", reply);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 1 && stat.ntotal == 3);
+    m61_free(reply);
+
+    // The private heap is used again after detaching
+    m61_shared_heap_detach();
+    void* ptr = m61_malloc(10);
+    assert(ptr);
+    m61_free(ptr);
+    stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.ntotal == 1);
+    printf("OK\n");
+}
+
+//! hello from the child
+//! OK
@@ -0,0 +1,114 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/wait.h>
+// Compare handing buffers from a producer process to a consumer process
+// through the shared heap, passing only offsets, with copying the buffers
+// through a pipe.
+
+static const int nmessages = 2000;
+static const size_t message_size = 64 << 10;
+
+static void read_fully(int fd, void* buf, size_t sz) {
+    for (size_t pos = 0; pos != sz; ) {
+        ssize_t n = read(fd, (char*) buf + pos, sz - pos);
+        assert(n > 0);
+        pos += n;
+    }
+}
+
+static void write_fully(int fd, const void* buf, size_t sz) {
+    for (size_t pos = 0; pos != sz; ) {
+        ssize_t n = write(fd, (const char*) buf + pos, sz - pos);
+        assert(n > 0);
+        pos += n;
+    }
+}
+
+static unsigned long checksum(const char* buf) {
+    unsigned long sum = 0;
+    for (size_t i = 0; i < message_size; i += 64) {
+        sum += (unsigned char) buf[i];
+    }
+    return sum;
+}
+
+// Runs `producer` in a child process and `consumer` in this one, connected by a pipe
+template <typename P, typename C>
+static double run(P producer, C consumer) {
+    int fds[2];
+    int r = pipe(fds);
+    assert(r == 0);
+    auto start = std::chrono::steady_clock::now();
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        close(fds[0]);
+        producer(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+    unsigned long sum = consumer(fds[0]);
+    close(fds[0]);
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    std::chrono::duration<double> runtime = std::chrono::steady_clock::now() - start;
+    assert(sum == (unsigned long) nmessages * (message_size / 64) * 61);
+    return runtime.count();
+}
+
+int main() {
+    int fd = m61_shared_heap_create(nullptr, 16 << 20);
+    assert(fd >= 0);
+
+    double zero_copy = run([] (int out) {
+        for (int i = 0; i != nmessages; ++i) {
+            char* buf;
+            // Wait for the consumer when the heap is full
+            while (!(buf = (char*) m61_malloc(message_size))) {
+                sched_yield();
+            }
+            memset(buf, 61, message_size);
+            size_t offset = m61_shared_offset(buf);
+            write_fully(out, &offset, sizeof(offset));
+        }
+    }, [] (int in) {
+        unsigned long sum = 0;
+        for (int i = 0; i != nmessages; ++i) {
+            size_t offset;
+            read_fully(in, &offset, sizeof(offset));
+            char* buf = (char*) m61_shared_pointer(offset);
+            sum += checksum(buf);
+            m61_free(buf);
+        }
+        return sum;
+    });
+
+    double copy = run([] (int out) {
+        static char buf[message_size];
+        for (int i = 0; i != nmessages; ++i) {
+            memset(buf, 61, message_size);
+            write_fully(out, buf, message_size);
+        }
+    }, [] (int in) {
+        static char buf[message_size];
+        unsigned long sum = 0;
+        for (int i = 0; i != nmessages; ++i) {
+            read_fully(in, buf, message_size);
+            sum += checksum(buf);
+        }
+        return sum;
+    });
+
+    printf("shared heap %.3fs, pipe copy %.3fs\n", zero_copy, copy);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.ntotal == nmessages);
+}
+
+//!!TIME
+//! shared heap ???s, pipe copy ???s
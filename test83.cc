@@ -0,0 +1,76 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <unistd.h>
+#include <sys/wait.h>
+// Check the persistent heap: a child process builds a list in a heap file,
+// and the parent reopens the file and finds the list through the root
+// pointer.
+
+struct node {
+    node* next;
+    int value;
+};
+
+int main() {
+    char path[] = "/tmp/m61test83.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        bool opened = m61_persistent_heap_open(path, 1 << 20);
+        assert(opened && m61_get_root() == nullptr);
+        node* list = nullptr;
+        for (int i = 0; i != 10; ++i) {
+            node* n = (node*) m61_malloc(sizeof(node));
+            n->next = list;
+            n->value = i;
+            list = n;
+        }
+        m61_set_root(list);
+        m61_persistent_heap_close();
+        _exit(0);
+    }
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    bool opened = m61_persistent_heap_open(path, 1 << 20);
+    assert(opened);
+    int sum = 0;
+    for (node* n = (node*) m61_get_root(); n; n = n->next) {
+        sum += n->value;
+    }
+    printf("sum %d\n", sum);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 10);
+
+    // Recovered blocks are freed and their space reused like any other
+    node* list = (node*) m61_get_root();
+    m61_free(list->next);
+    m61_print_leak_report();
+    m61_persistent_heap_close();
+    unlink(path);
+
+    // The private heap is used again after closing
+    stat = m61_get_statistics();
+    assert(stat.nactive == 0 && stat.ntotal == 0);
+    printf("OK\n");
+}
+
+//! sum 45
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! LEAK CHECK: test83.cc:30: allocated object ??{\w+}?? with size 16
+//! OK
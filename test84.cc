@@ -0,0 +1,64 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <chrono>
+#include <unistd.h>
+// Compare reopening a persistent heap that holds a dataset with building
+// the same dataset again.
+
+struct record {
+    record* next;
+    unsigned long key;
+    char value[80];
+};
+
+static const int nrecords = 200000;
+
+static unsigned long sum_keys(record* list) {
+    unsigned long sum = 0;
+    for (record* r = list; r; r = r->next) {
+        sum += r->key;
+    }
+    return sum;
+}
+
+int main() {
+    char path[] = "/tmp/m61test84.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+    unlink(path);
+
+    auto start = std::chrono::steady_clock::now();
+    bool opened = m61_persistent_heap_open(path, 64 << 20);
+    assert(opened);
+    record* list = nullptr;
+    for (int i = 0; i != nrecords; ++i) {
+        record* r = (record*) m61_malloc(sizeof(record));
+        assert(r);
+        r->next = list;
+        r->key = i * 2654435761UL;
+        snprintf(r->value, sizeof(r->value), "value %d", i);
+        list = r;
+    }
+    m61_set_root(list);
+    unsigned long sum = sum_keys(list);
+    std::chrono::duration<double> build = std::chrono::steady_clock::now() - start;
+    m61_persistent_heap_close();
+
+    start = std::chrono::steady_clock::now();
+    opened = m61_persistent_heap_open(path, 64 << 20);
+    assert(opened);
+    assert(sum_keys((record*) m61_get_root()) == sum);
+    std::chrono::duration<double> reopen = std::chrono::steady_clock::now() - start;
+
+    printf("build %.3fs, reopen %.3fs\n", build.count(), reopen.count());
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == nrecords);
+    m61_persistent_heap_close();
+    unlink(path);
+}
+
+//!!TIME
+//! build ???s, reopen ???s
@@ -0,0 +1,63 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/wait.h>
+// Check heap snapshots: a child process builds some allocations and takes a
+// snapshot, and the parent restores it and uses the allocations.
+
+int main() {
+    char path[] = "/tmp/m61test85.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    int fds[2];
+    int r = pipe(fds);
+    assert(r == 0);
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        char* greeting = (char*) m61_malloc(100);
+        strcpy(greeting, "hello from the snapshot");
+        char* cache = (char*) m61_malloc_hint(200, M61_LONG_LIVED);
+        strcpy(cache, "long-lived");
+        char* ptrs[2] = {greeting, cache};
+        bool ok = m61_snapshot(path);
+        assert(ok);
+        ssize_t w = write(fds[1], ptrs, sizeof(ptrs));
+        assert(w == sizeof(ptrs));
+        _exit(0);
+    }
+    char* ptrs[2];
+    ssize_t n = read(fds[0], ptrs, sizeof(ptrs));
+    assert(n == sizeof(ptrs));
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    // A heap with active allocations cannot be replaced
+    void* ptr = m61_malloc(10);
+    bool ok = m61_restore(path);
+    assert(!ok && errno == EBUSY);
+    m61_free(ptr);
+
+    ok = m61_restore(path);
+    assert(ok);
+    unlink(path);
+    printf("%s, %s\n", ptrs[0], ptrs[1]);
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 2 && stat.active_size == 300);
+
+    // The restored heap works like any other
+    m61_free(ptrs[1]);
+    char* more = (char*) m61_malloc(50);
+    assert(more > ptrs[0]);
+    m61_free(more);
+    m61_print_leak_report();
+}
+
+//! hello from the snapshot, long-lived
+//! LEAK CHECK: test85.cc:23: allocated object ??{\w+}?? with size 100
@@ -0,0 +1,101 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <cinttypes>
+#include <unistd.h>
+#include <sys/wait.h>
+// Check that restoring a heap snapshot does not read the heap in. A child
+// process builds an index that fills half the heap and takes a snapshot;
+// the parent restores it, which should touch only a few pages, then walks
+// the index. The heap is 64 MiB unless M61_HEAP_SIZE says otherwise, e.g.
+// M61_HEAP_SIZE=1073741824 for 1 GiB.
+
+struct record {
+    record* next;
+    unsigned long key;
+    char value[80];
+};
+
+static unsigned long sum_keys(record* list) {
+    unsigned long sum = 0;
+    for (record* r = list; r; r = r->next) {
+        sum += r->key;
+    }
+    return sum;
+}
+
+// Returns the number of resident kilobytes of the mappings that overlap
+// [`min`, `max`).
+static unsigned long resident_kb(uintptr_t min, uintptr_t max) {
+    FILE* f = fopen("/proc/self/smaps", "r");
+    assert(f);
+    char line[256];
+    bool in_range = false;
+    unsigned long kb = 0;
+    while (fgets(line, sizeof(line), f)) {
+        uintptr_t start, end;
+        unsigned long n;
+        if (sscanf(line, "%" SCNxPTR "-%" SCNxPTR, &start, &end) == 2) {
+            in_range = start < max && min < end;
+        } else if (in_range && sscanf(line, "Rss: %lu kB", &n) == 1) {
+            kb += n;
+        }
+    }
+    fclose(f);
+    return kb;
+}
+
+int main() {
+    setenv("M61_HEAP_SIZE", "67108864", 0);
+    size_t heap_size = strtoull(getenv("M61_HEAP_SIZE"), nullptr, 0);
+    char path[] = "/tmp/m61test86.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    close(fd);
+
+    struct result {
+        record* list;
+        unsigned long sum;
+    } res;
+    int fds[2];
+    int r = pipe(fds);
+    assert(r == 0);
+    pid_t p = fork();
+    assert(p >= 0);
+    if (p == 0) {
+        record* list = nullptr;
+        size_t nrecords = heap_size / 2 / m61_block_size(sizeof(record));
+        for (size_t i = 0; i != nrecords; ++i) {
+            record* rec = (record*) m61_malloc(sizeof(record));
+            assert(rec);
+            rec->next = list;
+            rec->key = i * 2654435761UL;
+            snprintf(rec->value, sizeof(rec->value), "value %zu", i);
+            list = rec;
+        }
+        res = {list, sum_keys(list)};
+        bool ok = m61_snapshot(path);
+        assert(ok);
+        ssize_t w = write(fds[1], &res, sizeof(res));
+        assert(w == sizeof(res));
+        _exit(0);
+    }
+    ssize_t n = read(fds[0], &res, sizeof(res));
+    assert(n == sizeof(res));
+    int status;
+    waitpid(p, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+
+    bool ok = m61_restore(path);
+    assert(ok);
+    m61_statistics stat = m61_get_statistics();
+    unsigned long kb = resident_kb(stat.heap_min, stat.heap_max);
+    unsigned long span_kb = (stat.heap_max - stat.heap_min) / 1024;
+    assert(sum_keys(res.list) == res.sum);
+    unlink(path);
+
+    printf("restore touched %s\n", kb < span_kb / 64 ? "a few pages" : "the heap");
+}
+
+//! restore touched a few pages
@@ -0,0 +1,50 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check heap instances: each heap has its own buffer, statistics and leak
+// report, and the default heap is not affected by them.
+
+int main() {
+    m61_heap* h1 = m61_heap_create(1 << 16);
+    m61_heap* h2 = m61_heap_create(1 << 20);
+    assert(h1 && h2);
+
+    char* a = (char*) m61_heap_malloc(h1, 100);
+    char* b = (char*) m61_heap_calloc(h2, 10, 20);
+    char* c = (char*) m61_malloc(30);
+    assert(a && b && c);
+    for (int i = 0; i != 200; ++i) {
+        assert(b[i] == 0);
+    }
+    strcpy(a, "tenant one");
+    a = (char*) m61_heap_realloc(h1, a, 1000);
+    assert(strcmp(a, "tenant one") == 0);
+
+    // A heap's buffer is its limit
+    void* big = m61_heap_malloc(h1, 1 << 16);
+    assert(big == nullptr);
+
+    m61_statistics s1 = m61_heap_get_statistics(h1);
+    m61_statistics s2 = m61_heap_get_statistics(h2);
+    m61_statistics s0 = m61_get_statistics();
+    printf("h1: %llu active, %llu total, %llu fail\n", s1.nactive, s1.ntotal, s1.nfail);
+    printf("h2: %llu active, %llu total, %llu fail\n", s2.nactive, s2.ntotal, s2.nfail);
+    printf("default: %llu active, %llu total, %llu fail\n", s0.nactive, s0.ntotal, s0.nfail);
+    m61_heap_print_leak_report(h1);
+
+    // Destroying a heap releases its allocations without touching the others
+    m61_heap_destroy(h1);
+    m61_heap_free(h2, b);
+    m61_heap_destroy(h2);
+    m61_free(c);
+    s0 = m61_get_statistics();
+    assert(s0.nactive == 0);
+    printf("OK\n");
+}
+
+//! h1: 1 active, 2 total, 1 fail
+//! h2: 1 active, 1 total, 0 fail
+//! default: 1 active, 1 total, 0 fail
+//! LEAK CHECK: test87.cc:21: allocated object ??{\w+}?? with size 1000
+//! OK
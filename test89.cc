@@ -0,0 +1,67 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <csignal>
+// Check the emergency reserve: signal handlers allocate from it, and
+// m61_malloc falls back to it once the heap is exhausted.
+
+static void* handler_ptr;
+
+static void handle_signal(int) {
+    char* buf = (char*) m61_malloc_signal_safe(200);
+    if (buf) {
+        strcpy(buf, "formatted in a signal handler");
+    }
+    handler_ptr = buf;
+}
+
+int main() {
+    signal(SIGUSR1, handle_signal);
+    raise(SIGUSR1);
+    assert(handler_ptr && m61_is_emergency_allocation(handler_ptr));
+    printf("%s\n", (char*) handler_ptr);
+    m61_free_signal_safe(handler_ptr);
+
+    // The reserve is 64 KiB big
+    void* too_big = m61_malloc_signal_safe(64 << 10);
+    assert(too_big == nullptr);
+
+    // Exhaust the heap
+    static void* ptrs[1000];
+    int nptrs = 0;
+    for (size_t sz = 1 << 20; sz != 0; sz /= 2) {
+        void* ptr;
+        while ((ptr = m61_malloc(sz)) && !m61_is_emergency_allocation(ptr)) {
+            ptrs[nptrs++] = ptr;
+        }
+        m61_free(ptr);
+    }
+    m61_statistics before = m61_get_statistics();
+
+    // Small allocations still succeed, from the reserve
+    char* log = (char*) m61_malloc(100);
+    assert(log && m61_is_emergency_allocation(log));
+    strcpy(log, "out of memory");
+    log = (char*) m61_realloc(log, 2000);
+    assert(log && m61_is_emergency_allocation(log));
+    printf("%s\n", log);
+    assert(m61_malloc_usable_size(log) == 2000);
+    m61_statistics during = m61_get_statistics();
+    assert(during.nactive == before.nactive + 1 && during.active_size == before.active_size + 2000);
+    assert(during.nfail == before.nfail);
+
+    // Larger allocations fail
+    assert(m61_malloc(1 << 16) == nullptr);
+
+    // Batch frees handle reserve allocations too
+    ptrs[nptrs++] = log;
+    m61_free_batch(ptrs, nptrs);
+    m61_statistics after = m61_get_statistics();
+    assert(after.nactive == 0 && after.active_size == 0);
+    printf("OK\n");
+}
+
+//! formatted in a signal handler
+//! out of memory
+//! OK
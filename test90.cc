@@ -0,0 +1,69 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+#include <new>
+// Check the new handler integration of the operator new replacement: when
+// the heap is exhausted, the new handler runs and sheds load before new
+// takes memory from the emergency reserve.
+
+static char* cache;
+static int nhandled;
+
+static void shed_load() {
+    // Logging still works: its allocation may come from the reserve
+    char* msg = (char*) m61_malloc(100);
+    assert(msg);
+    snprintf(msg, 100, "new handler called, dropping the cache");
+    printf("%s\n", msg);
+    m61_free(msg);
+
+    ++nhandled;
+    delete[] cache;
+    cache = nullptr;
+    std::set_new_handler(nullptr);
+}
+
+static char* ptrs[2000];
+static int nptrs;
+
+// Allocates heap memory until allocations of at least 1 KiB come from the reserve
+static void fill_heap() {
+    for (size_t sz = 1 << 20; sz >= 1024; sz /= 2) {
+        while (char* ptr = new (std::nothrow) char[sz]) {
+            if (m61_is_emergency_allocation(ptr)) {
+                delete[] ptr;
+                break;
+            }
+            ptrs[nptrs++] = ptr;
+        }
+    }
+}
+
+int main() {
+    cache = new char[1 << 20];
+    fill_heap();
+
+    std::set_new_handler(shed_load);
+    char* object = new char[1000];
+    assert(!m61_is_emergency_allocation(object));
+    printf("handled %d time(s)\n", nhandled);
+
+    // Without a new handler, the reserve is used
+    fill_heap();
+    char* emergency = new char[1000];
+    assert(m61_is_emergency_allocation(emergency));
+
+    delete[] emergency;
+    delete[] object;
+    for (int i = 0; i != nptrs; ++i) {
+        delete[] ptrs[i];
+    }
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nactive == 0);
+    printf("OK\n");
+}
+
+//! new handler called, dropping the cache
+//! handled 1 time(s)
+//! OK
@@ -0,0 +1,69 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstring>
+// Check pressure callbacks on a workload that hovers near the heap limit: a
+// cache keeps growing, and a pressure callback evicts its oldest half
+// whenever an allocation does not fit.
+
+static const int capacity = 1 << 14;
+static void* cache[capacity];
+static int first = 0, last = 0;       // cache entries are cache[first, last)
+static int ncalls = 0;
+
+static void evict(m61_heap* p_heap, size_t sz, void* arg) {
+    assert(p_heap == nullptr && sz > 0 && arg == cache);
+    ++ncalls;
+    int keep = (last - first) / 2;
+    while (last - first > keep) {
+        m61_free(cache[first % capacity]);
+        ++first;
+    }
+}
+
+int main() {
+    bool ok = m61_register_pressure_callback(evict, cache);
+    assert(ok);
+
+    std::default_random_engine randomness(61);
+    for (int i = 0; i != 100000; ++i) {
+        if (last - first == capacity) {
+            m61_free(cache[first % capacity]);
+            ++first;
+        }
+        void* ptr = m61_malloc(uniform_int(100, 4000, randomness));
+        assert(ptr && !m61_is_emergency_allocation(ptr));
+        cache[last % capacity] = ptr;
+        ++last;
+    }
+    m61_statistics stat = m61_get_statistics();
+    assert(stat.nfail == 0 && ncalls > 0);
+    printf("%llu allocations, %d pressure callbacks, %llu failures\n", stat.ntotal, ncalls, stat.nfail);
+
+    // Without the callback, the same workload fails
+    m61_unregister_pressure_callback(evict, cache);
+    int nfailed = 0;
+    for (int i = 0; i != 100000 && !nfailed; ++i) {
+        void* ptr = m61_malloc(uniform_int(100, 4000, randomness));
+        if (!ptr || m61_is_emergency_allocation(ptr)) {
+            ++nfailed;
+            m61_free(ptr);
+        } else {
+            cache[last % capacity] = ptr;
+            ++last;
+            assert(last - first <= capacity);
+        }
+    }
+    assert(nfailed);
+
+    while (first != last) {
+        m61_free(cache[first % capacity]);
+        ++first;
+    }
+    stat = m61_get_statistics();
+    assert(stat.nactive == 0);
+    printf("OK\n");
+}
+
+//! 100000 allocations, ??? pressure callbacks, 0 failures
+//! OK
@@ -0,0 +1,81 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/stat.h>
+// Check cgroup-aware sizing and soft limits with a fake cgroup directory:
+// the heap is capped at memory.max, and near memory.high freed blocks are
+// reused and pressure callbacks run before the heap grows.
+
+static int ncalls = 0;
+
+static void count_pressure(m61_heap*, size_t, void*) {
+    ++ncalls;
+}
+
+static void write_file(const char* dir, const char* name, const char* value) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE* f = fopen(path, "w");
+    assert(f);
+    fputs(value, f);
+    fclose(f);
+}
+
+int main() {
+    char dir[] = "/tmp/m61test92.XXXXXX";
+    char* d = mkdtemp(dir);
+    assert(d);
+    write_file(dir, "memory.max", "4194304\n");
+    write_file(dir, "memory.high", "2097152\n");
+    setenv("M61_CGROUP_DIR", dir, 1);
+    m61_register_pressure_callback(count_pressure, nullptr);
+
+    // The heap is no bigger than memory.max
+    void* big = m61_malloc(5 << 20);
+    assert(big == nullptr);
+    m61_statistics stat = m61_get_statistics();
+    printf("soft limit %llu\n", stat.soft_limit);
+
+    // Leave holes, then keep allocating: the holes are reused near the limit
+    static void* ptrs[4000];
+    for (int i = 0; i != 1500; ++i) {
+        ptrs[i] = m61_malloc(1000);
+    }
+    for (int i = 0; i < 1500; i += 2) {
+        m61_free(ptrs[i]);
+        ptrs[i] = nullptr;
+    }
+    for (int i = 1500; i != 2200; ++i) {
+        ptrs[i] = m61_malloc(1000);
+        assert(ptrs[i]);
+    }
+    stat = m61_get_statistics();
+    assert(stat.footprint <= stat.soft_limit && ncalls > 0);
+    printf("footprint within the soft limit\n");
+
+    // Without a soft limit, the heap grows instead
+    m61_set_soft_limit(0);
+    for (int i = 3000; i != 4000; ++i) {
+        ptrs[i] = m61_malloc(1000);
+        assert(ptrs[i]);
+    }
+    stat = m61_get_statistics();
+    assert(stat.footprint > (2 << 20) && stat.soft_limit == 0);
+
+    for (int i = 0; i != 4000; ++i) {
+        m61_free(ptrs[i]);
+    }
+    char path[256];
+    snprintf(path, sizeof(path), "%s/memory.max", dir);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/memory.high", dir);
+    unlink(path);
+    rmdir(dir);
+    printf("OK\n");
+}
+
+//! soft limit 2097152
+//! footprint within the soft limit
+//! OK
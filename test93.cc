@@ -0,0 +1,36 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check the size histogram: allocations are counted by log2 size class,
+// and freed ones leave the active counts.
+
+int main() {
+    void* small[10];
+    for (int i = 0; i != 10; ++i) {
+        small[i] = m61_malloc(32);
+    }
+    void* medium = m61_malloc(1000);
+    void* large = m61_malloc(1 << 20);
+    void* batch[4];
+    size_t n = m61_malloc_batch(40, 4, batch);
+    assert(n == 4);
+    for (int i = 0; i != 5; ++i) {
+        m61_free(small[i]);
+    }
+    m61_free_batch(batch, 4);
+
+    m61_size_histogram sizes = m61_get_size_histogram();
+    assert(sizes.nactive[6] == 5 && sizes.ntotal[6] == 14 && sizes.active_size[6] == 160);
+    m61_print_size_histogram();
+
+    for (int i = 5; i != 10; ++i) {
+        m61_free(small[i]);
+    }
+    m61_free(medium);
+    m61_free(large);
+}
+
+//! size class              active  active bytes       total   total bytes
+//!         32-63                  5           160          14           480
+//!        512-1023                1          1000           1          1000
+//!    1048576-2097151             1       1048576           1       1048576
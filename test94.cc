@@ -0,0 +1,36 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check peak tracking: peaks remember the highest usage and the allocation
+// count at which it was reached, and m61_reset_peak starts a new phase.
+
+int main() {
+    // Phase 1: ten allocations, then free them
+    void* ptrs[10];
+    for (int i = 0; i != 10; ++i) {
+        ptrs[i] = m61_malloc(1000);
+    }
+    for (int i = 0; i != 10; ++i) {
+        m61_free(ptrs[i]);
+    }
+    m61_statistics stat = m61_get_statistics();
+    printf("phase 1: peak %llu active at %llu, peak %llu bytes at %llu\n",
+           stat.peak_nactive, stat.peak_nactive_at, stat.peak_active_size, stat.peak_active_size_at);
+    assert(stat.peak_footprint >= 10000 && stat.peak_footprint_at == 10);
+    assert(stat.peak_heap_span >= 10000 && stat.peak_heap_span_at == 10);
+
+    // Phase 2: the peak restarts from the current usage
+    m61_reset_peak();
+    void* a = m61_malloc(100);
+    void* b = m61_malloc(200);
+    m61_free(a);
+    void* c = m61_malloc(50);
+    stat = m61_get_statistics();
+    printf("phase 2: peak %llu active at %llu, peak %llu bytes at %llu\n",
+           stat.peak_nactive, stat.peak_nactive_at, stat.peak_active_size, stat.peak_active_size_at);
+    m61_free(b);
+    m61_free(c);
+}
+
+//! phase 1: peak 10 active at 10, peak 10000 bytes at 10
+//! phase 2: peak 2 active at 12, peak 300 bytes at 12
@@ -0,0 +1,55 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+// Check fragmentation metrics: free blocks are counted as they are freed,
+// merged and reused, and the largest free block follows them.
+
+static void print_fragmentation(const char* phase) {
+    m61_fragmentation frag = m61_get_fragmentation();
+    printf("%s: %llu free blocks, %llu bytes, largest %llu, external %.1f%%, overhead %llu\n", phase,
+           frag.nfree, frag.free_size, frag.largest_free, frag.external * 100, frag.overhead);
+}
+
+int main() {
+    // The buffer holds exactly ten blocks, so later allocations must reuse holes
+    setenv("M61_HEAP_SIZE", "10720", 1);
+    void* ptrs[10];
+    for (int i = 0; i != 10; ++i) {
+        ptrs[i] = m61_malloc(1000);
+    }
+    print_fragmentation("allocated");
+
+    // Freeing every other block leaves holes of the same size
+    for (int i = 0; i < 10; i += 2) {
+        m61_free(ptrs[i]);
+    }
+    print_fragmentation("holes");
+
+    // Freeing a block between two holes merges them
+    m61_free(ptrs[1]);
+    print_fragmentation("merged");
+
+    // Reusing the largest hole splits it
+    void* ptr = m61_malloc(2000);
+    print_fragmentation("reused");
+    m61_print_extended_statistics();
+
+    // Freeing everything returns the space to the buffer
+    m61_free(ptr);
+    for (int i = 3; i < 10; i += 2) {
+        m61_free(ptrs[i]);
+    }
+    print_fragmentation("freed");
+}
+
+//! allocated: 0 free blocks, 0 bytes, largest 0, external 0.0%, overhead 720
+//! holes: 5 free blocks, 5360 bytes, largest 1072, external 80.0%, overhead 360
+//! merged: 4 free blocks, 6432 bytes, largest 3216, external 50.0%, overhead 288
+//! reused: 4 free blocks, 4352 bytes, largest 1136, external 73.9%, overhead 368
+//! alloc count: active          5   total         11   fail          0
+//! alloc size:  active       6000   total      12000   fail          0
+//! footprint:   current     10720   peak       10720   overhead     368
+//! free blocks: count           4   size        4352   largest     1136
+//! fragmentation: external  73.9%
+//! freed: 0 free blocks, 0 bytes, largest 0, external 0.0%, overhead 0
@@ -0,0 +1,45 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check latency tracking: only calls made while it is enabled are counted,
+// and calls made by other m61 functions are not counted separately.
+
+int main() {
+    // Not recorded
+    void* ptr = m61_malloc(10);
+    m61_free(ptr);
+
+    m61_set_latency_tracking(true);
+    void* ptrs[1000];
+    for (int i = 0; i != 1000; ++i) {
+        ptrs[i] = m61_malloc(i + 1);
+    }
+    // These reallocs allocate and free internally, which is not recorded as malloc and free calls
+    for (int i = 0; i < 1000; i += 2) {
+        ptrs[i] = m61_realloc(ptrs[i], 2000);
+        assert(ptrs[i]);
+    }
+    void* zeroed[200];
+    for (int i = 0; i != 200; ++i) {
+        zeroed[i] = m61_calloc(i + 1, 8);
+    }
+    for (int i = 0; i != 1000; ++i) {
+        m61_free(ptrs[i]);
+    }
+    for (int i = 0; i != 200; ++i) {
+        m61_free(zeroed[i]);
+    }
+    m61_set_latency_tracking(false);
+
+    // Not recorded
+    ptr = m61_malloc(10);
+    m61_free(ptr);
+
+    m61_print_latency_report();
+}
+
+//! operation           count        p50        p90        p99      p99.9        max
+//! malloc               1000 ???
+//! free                 1200 ???
+//! realloc               500 ???
+//! calloc                200 ???
@@ -0,0 +1,37 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check the site report: sites are sorted by active bytes and count their
+// active, total and freed allocations and the lifetimes of the freed ones.
+
+int main() {
+    void* kept[10];
+    for (int i = 0; i != 10; ++i) {
+        kept[i] = m61_malloc(100);
+    }
+
+    // Each temporary is freed right after the next allocation, so it lives for 2
+    void* temporary = m61_malloc(50);
+    for (int i = 0; i != 20; ++i) {
+        void* next = m61_malloc(50);
+        m61_free(temporary);
+        temporary = next;
+    }
+
+    void* big = m61_malloc(5000);
+    m61_free(big);
+    big = m61_malloc(2000);
+
+    m61_print_site_report(3);
+
+    for (int i = 0; i != 10; ++i) {
+        m61_free(kept[i]);
+    }
+    m61_free(temporary);
+    m61_free(big);
+}
+
+//! ??? active  active bytes       total   total bytes       frees  mean lifetime  site
+//!          1          2000           1          2000           0              -  test97.cc:23
+//!         10          1000          10          1000           0              -  test97.cc:10
+//!          1            50          20          1000          19              2  test97.cc:16
@@ -0,0 +1,48 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check that a heap instance is limited to its buffer: it does not fall
+// back to the emergency reserve, but it does call the pressure callbacks
+// with itself, and they can make room in it.
+
+static m61_heap* h;
+static void* spare = nullptr;
+static int ncallbacks = 0;
+
+static void release_spare(m61_heap* p_heap, size_t sz, void*) {
+    assert(p_heap == h && sz == 900);
+    ++ncallbacks;
+    // The m61_malloc family uses the process's heap while callbacks run
+    void* ptr = m61_malloc(10);
+    assert(ptr && m61_heap_get_statistics(h).nactive == 4);
+    m61_free(ptr);
+    if (spare) {
+        m61_heap_free(p_heap, spare);
+        spare = nullptr;
+    }
+}
+
+int main() {
+    m61_register_pressure_callback(release_spare, nullptr);
+
+    h = m61_heap_create(4096);
+    assert(h);
+    int nallocs = 0;
+    while (void* ptr = m61_heap_malloc(h, 900)) {
+        assert(!m61_is_emergency_allocation(ptr));
+        ++nallocs;
+        if (nallocs == 1) {
+            spare = ptr;
+        }
+    }
+    m61_statistics stat = m61_heap_get_statistics(h);
+    printf("%d allocations, %llu failed, %d callbacks\n", nallocs, stat.nfail, ncallbacks);
+    m61_heap_destroy(h);
+
+    // The whole reserve is still available
+    void* ptr = m61_malloc_signal_safe(1000);
+    assert(ptr);
+    m61_free_signal_safe(ptr);
+}
+
+//! 5 allocations, 1 failed, 2 callbacks
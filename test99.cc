@@ -0,0 +1,34 @@
+#include "m61.hh"
+#include <cstdio>
+#include <cassert>
+// Check that a mark can be released after the buffer position went below
+// it: allocations made since the mark below it are released too.
+
+int main() {
+    void* before = m61_malloc(100);
+    m61_checkpoint mark = m61_mark();
+    // The buffer position goes below the mark
+    m61_free(before);
+    void* ptr = m61_malloc(50);
+    assert(ptr);
+    m61_release(mark);
+
+    m61_statistics stat = m61_get_statistics();
+    printf("%llu active, footprint %llu\n", stat.nactive, stat.footprint);
+
+    // Blocks allocated before the mark stay
+    before = m61_malloc(100);
+    mark = m61_mark();
+    void* inside = m61_malloc(100);
+    m61_free(inside);
+    ptr = m61_malloc(50);
+    assert(ptr);
+    m61_release(mark);
+    stat = m61_get_statistics();
+    printf("%llu active\n", stat.nactive);
+    m61_free(before);
+    m61_print_leak_report();
+}
+
+//! 0 active, footprint 0
+//! 1 active